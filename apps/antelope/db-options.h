@@ -104,6 +104,15 @@
 #endif /* DB_MAX_ELEMENT_SIZE */
 
 
+/* The size of the buffer into which relational selections read
+   consecutive rows with a single storage call. The rows in the buffer
+   are filtered in one processing step, so db_process() returns DB_OK
+   once for all of them if none matches. Set to 0 to read and process
+   one row at a time. */
+#ifndef DB_SCAN_BLOCK_SIZE
+#define DB_SCAN_BLOCK_SIZE		0
+#endif /* DB_SCAN_BLOCK_SIZE */
+
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
 #ifndef DB_VM_BYTECODE_SIZE
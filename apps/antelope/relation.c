@@ -88,6 +88,21 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+#if DB_SCAN_BLOCK_SIZE
+#if DB_SCAN_BLOCK_SIZE < DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE
+#error DB_SCAN_BLOCK_SIZE must be large enough for the longest row.
+#endif
+
+/*
+ * The scan block holds the rows scan_first to scan_first + scan_count - 1
+ * of the relation scan_rel. It is emptied when a selection starts.
+ */
+static unsigned char scan_block[DB_SCAN_BLOCK_SIZE];
+static relation_t *scan_rel;
+static tuple_id_t scan_first;
+static tuple_id_t scan_count;
+#endif /* DB_SCAN_BLOCK_SIZE */
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -542,7 +557,9 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
   PRINTF(")\n");
 
-  rel->cardinality++;
+  if(rel->cardinality != INVALID_TUPLE) {
+    rel->cardinality++;
+  }
   rel->next_row++;
   return storage_put_row(rel, record);
 }
@@ -704,6 +721,9 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
+#if DB_SCAN_BLOCK_SIZE
+  scan_rel = NULL;
+#endif
 
   return DB_OK;
 }
@@ -731,6 +751,50 @@ relation_process_remove(void *handle_ptr)
 }
 #endif
 
+#if DB_SCAN_BLOCK_SIZE
+/*
+ * Points to a row in the scan block. If the row is not in the block,
+ * the block is refilled with the row and, if the rows are being
+ * processed in order, as many of the following rows as fit.
+ */
+static db_result_t
+scan_get_row(relation_t *rel, tuple_id_t tuple_id, unsigned char **tuple)
+{
+  tuple_id_t cardinality;
+  tuple_id_t count;
+
+  if(rel != scan_rel || tuple_id < scan_first ||
+     tuple_id >= scan_first + scan_count) {
+    cardinality = relation_cardinality(rel);
+    if(cardinality == INVALID_TUPLE) {
+      return DB_STORAGE_ERROR;
+    }
+    if(tuple_id >= cardinality) {
+      return DB_FINISHED;
+    }
+
+    count = DB_SCAN_BLOCK_SIZE / rel->row_length;
+    if(rel == scan_rel && tuple_id != scan_first + scan_count) {
+      count = 1;
+    }
+    if(count > cardinality - tuple_id) {
+      count = cardinality - tuple_id;
+    }
+
+    scan_rel = NULL;
+    if(DB_ERROR(storage_get_rows(rel, tuple_id, count, scan_block))) {
+      return DB_STORAGE_ERROR;
+    }
+    scan_rel = rel;
+    scan_first = tuple_id;
+    scan_count = count;
+  }
+
+  *tuple = scan_block + (tuple_id - scan_first) * rel->row_length;
+  return DB_OK;
+}
+#endif /* DB_SCAN_BLOCK_SIZE */
+
 db_result_t
 relation_process_select(void *handle_ptr)
 {
@@ -746,6 +810,7 @@ relation_process_select(void *handle_ptr)
   uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  unsigned char *tuple;
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
@@ -753,6 +818,9 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+#if DB_SCAN_BLOCK_SIZE
+next_row:
+#endif
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -771,7 +839,12 @@ relation_process_select(void *handle_ptr)
 
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
+#if DB_SCAN_BLOCK_SIZE
+  result = scan_get_row(handle->rel, handle->tuple_id, &tuple);
+#else
   result = storage_get_row(handle->rel, &handle->tuple_id, row);
+  tuple = row;
+#endif
   handle->tuple_id++;
   if(DB_ERROR(result)) {
     PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
@@ -785,7 +858,7 @@ relation_process_select(void *handle_ptr)
 
   /* Process the attributes in the result relation. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
+    from_ptr = tuple + attr_map_ptr->from_offset;
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
@@ -823,7 +896,7 @@ relation_process_select(void *handle_ptr)
      lvm_execute(adt->lvm_instance) == wanted_result) {
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
+        from_ptr = tuple + attr_map_ptr->from_offset;
         result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
@@ -842,6 +915,15 @@ relation_process_select(void *handle_ptr)
     }
   }
 
+#if DB_SCAN_BLOCK_SIZE
+  /* Filter the rest of the rows in the scan block before returning. */
+  if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) &&
+     handle->rel == scan_rel &&
+     handle->tuple_id < scan_first + scan_count) {
+    goto next_row;
+  }
+#endif
+
   return DB_OK;
 
 end_aggregation:
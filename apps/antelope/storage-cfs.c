@@ -437,6 +437,31 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
   return DB_OK;
 }
 
+db_result_t
+storage_get_rows(relation_t *rel, tuple_id_t tuple_id, tuple_id_t count,
+                 storage_row_t rows)
+{
+  db_result_t result;
+  tuple_id_t i;
+
+  /* The caller has checked the tuple range against the cardinality,
+     so the rows are read without looking for the end of the file. */
+  result = storage_read(rel->tuple_storage, rows,
+                        (unsigned long)tuple_id * rel->row_length,
+                        (unsigned)count * rel->row_length);
+  if(DB_ERROR(result)) {
+    PRINTF("DB: Failed to read %lu rows from relation %s\n",
+           (unsigned long)count, rel->name);
+    return result;
+  }
+
+  for(i = 1; i <= count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
 {
@@ -90,6 +90,82 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * A directory cache maps file names to the first pages of the files,
+ * so that opening a file whose metadata is not cached does not require
+ * scanning the headers of all files. It is built at the first lookup
+ * and holds up to COFFEE_DIR_CACHE_SIZE - 1 files; lookups of files
+ * beyond that fall back to a scan. Each entry takes
+ * sizeof(coffee_page_t) + 2 bytes of RAM.
+ */
+#ifndef COFFEE_DIR_CACHE_SIZE
+#define COFFEE_DIR_CACHE_SIZE 0
+#endif
+
+/*
+ * End-of-file records let Coffee find the end of a file without reading
+ * its pages backwards in search of the last non-zero byte. A record is
+ * opened in the file header before the end of the file moves past the
+ * recorded one, and completed with the new end when the file is closed
+ * for writing or no longer open at all. As flash bits cannot be cleared
+ * without erasing, each such session uses up one of the
+ * COFFEE_EOF_RECORDS records of the header. Files whose records are
+ * used up are scanned as before, and so are files whose last record is
+ * still open after a reboot, which completes it. Setting this changes
+ * the header format, so the storage must be formatted.
+ */
+#ifndef COFFEE_EOF_RECORDS
+#define COFFEE_EOF_RECORDS 0
+#endif
+
+/*
+ * The read cache holds COFFEE_READ_CACHE_PAGES pages of the storage, so
+ * that small sequential file reads do not each reach the storage
+ * driver. When a read that continues the previous one misses the cache,
+ * COFFEE_READ_AHEAD_PAGES pages are loaded in one driver call; other
+ * misses, and reads of a page or more, go directly to the driver.
+ * Writes and erasures drop the pages that they modify. Each page takes
+ * COFFEE_PAGE_SIZE + 4 bytes of RAM.
+ */
+#ifndef COFFEE_READ_CACHE_PAGES
+#define COFFEE_READ_CACHE_PAGES 0
+#endif
+
+#ifndef COFFEE_READ_AHEAD_PAGES
+#define COFFEE_READ_AHEAD_PAGES \
+  (COFFEE_READ_CACHE_PAGES > 1 ? COFFEE_READ_CACHE_PAGES / 2 : 1)
+#endif
+
+#if COFFEE_READ_CACHE_PAGES && \
+    COFFEE_READ_AHEAD_PAGES > COFFEE_READ_CACHE_PAGES
+#error COFFEE_READ_AHEAD_PAGES must not exceed COFFEE_READ_CACHE_PAGES.
+#endif
+
+#if COFFEE_READ_CACHE_PAGES > 255
+#error COFFEE_READ_CACHE_PAGES must be at most 255.
+#endif
+
+/*
+ * With background garbage collection, removing a file polls a process
+ * that erases the sectors that hold only obsolete and free pages, so
+ * that reserving a file seldom has to collect garbage first. Each time
+ * the process runs, it erases sectors one at a time until it has spent
+ * COFFEE_GC_BUDGET rtimer ticks, and it then polls itself if there may
+ * be more to erase.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC 0
+#endif
+
+#ifndef COFFEE_GC_BUDGET
+#define COFFEE_GC_BUDGET 0
+#endif
+
+#if COFFEE_BACKGROUND_GC
+#include "sys/process.h"
+#include "sys/rtimer.h"
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -112,6 +188,9 @@
 #define GC_GREEDY   0
 /* "Reluctant" garbage collection stops after erasing one sector. */
 #define GC_RELUCTANT    1
+/* "Incremental" garbage collection erases the first sector that greedy
+   garbage collection would erase. */
+#define GC_INCREMENTAL    2
 
 /* File descriptor macros. */
 #define FD_VALID(fd) \
@@ -133,6 +212,7 @@
 #define HDR_FLAG_MODIFIED 0x8 /* Modified file, log exists. */
 #define HDR_FLAG_LOG    0x10  /* Log file. */
 #define HDR_FLAG_ISOLATED 0x20  /* Isolated page. */
+#define HDR_FLAG_EOF_LOST 0x40  /* End-of-file records used up. */
 
 /* File header macros. */
 #define CHECK_FLAG(hdr, flag) ((hdr).flags & (flag))
@@ -143,6 +223,7 @@
 #define HDR_MODIFIED(hdr) CHECK_FLAG(hdr, HDR_FLAG_MODIFIED)
 #define HDR_ISOLATED(hdr) CHECK_FLAG(hdr, HDR_FLAG_ISOLATED)
 #define HDR_OBSOLETE(hdr)   CHECK_FLAG(hdr, HDR_FLAG_OBSOLETE)
+#define HDR_EOF_LOST(hdr) CHECK_FLAG(hdr, HDR_FLAG_EOF_LOST)
 #define HDR_ACTIVE(hdr)   (HDR_ALLOCATED(hdr) && \
                            !HDR_OBSOLETE(hdr) && \
                            !HDR_ISOLATED(hdr))
@@ -169,6 +250,9 @@ struct file {
   int16_t record_count;
   uint8_t references;
   uint8_t flags;
+#if COFFEE_EOF_RECORDS
+  int8_t eof_record;
+#endif
 };
 
 /* The file descriptor structure. */
@@ -191,8 +275,52 @@ struct file_header {
   uint8_t deprecated_eof_hint;
   uint8_t flags;
   char name[COFFEE_NAME_LENGTH];
+#if COFFEE_EOF_RECORDS
+  uint32_t eof_records[COFFEE_EOF_RECORDS];
+#endif
 };
 
+#if COFFEE_EOF_RECORDS
+/* An end-of-file record is 0 while unused. A completed record holds
+   both flags and the end offset. */
+#define EOF_RECORD_OPEN   0x80000000UL
+#define EOF_RECORD_DONE   0x40000000UL
+#define EOF_RECORD_END(r) ((cfs_offset_t)((r) & 0x3fffffffUL))
+
+/* Values of the eof_record field of struct file besides the index of
+   the record that the file has open. */
+#define EOF_RECORD_NONE   -1
+#define EOF_RECORD_LOST   COFFEE_EOF_RECORDS
+#endif /* COFFEE_EOF_RECORDS */
+
+#if COFFEE_DIR_CACHE_SIZE
+/* A directory cache entry. Free entries have the page INVALID_PAGE. */
+struct dir_entry {
+  coffee_page_t page;
+  uint16_t hash;
+};
+
+#define DIR_CACHE_UNBUILT   0 /* Built at the next lookup. */
+#define DIR_CACHE_COMPLETE  1 /* Holds every file. */
+#define DIR_CACHE_PARTIAL   2 /* Some files did not fit. */
+#endif /* COFFEE_DIR_CACHE_SIZE */
+
+#if COFFEE_READ_CACHE_PAGES
+/* A read cache slot. The data of the slot is stored separately. */
+struct cache_slot {
+  coffee_page_t page;
+  uint8_t valid;
+};
+
+#define READ_CACHED(buf, size, offset)  read_cached((void *)(buf), (size), (offset))
+#define WRITE_FLASH(buf, size, offset)  write_flash((buf), (size), (offset))
+#define ERASE_FLASH(sector)             erase_flash(sector)
+#else
+#define READ_CACHED   COFFEE_READ
+#define WRITE_FLASH   COFFEE_WRITE
+#define ERASE_FLASH   COFFEE_ERASE
+#endif /* COFFEE_READ_CACHE_PAGES */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -211,18 +339,167 @@ static struct protected_mem_t {
   struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
   coffee_page_t next_free;
   char gc_wait;
+#if COFFEE_DIR_CACHE_SIZE
+  struct dir_entry dir_cache[COFFEE_DIR_CACHE_SIZE];
+  coffee_page_t dir_cache_count;
+  uint8_t dir_cache_state;
+#endif
+#if COFFEE_READ_CACHE_PAGES
+  struct cache_slot cache_slots[COFFEE_READ_CACHE_PAGES];
+  unsigned char cache_data[COFFEE_READ_CACHE_PAGES][COFFEE_PAGE_SIZE];
+  cfs_offset_t cache_next_offset;
+  uint8_t cache_victim;
+#endif
 } protected_mem;
 static struct file *const coffee_files = protected_mem.coffee_files;
 static struct file_desc *const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t *const next_free = &protected_mem.next_free;
 static char *const gc_wait = &protected_mem.gc_wait;
+#if COFFEE_DIR_CACHE_SIZE
+static struct dir_entry *const dir_cache = protected_mem.dir_cache;
+static coffee_page_t *const dir_cache_count = &protected_mem.dir_cache_count;
+static uint8_t *const dir_cache_state = &protected_mem.dir_cache_state;
+#endif
+#if COFFEE_READ_CACHE_PAGES
+static struct cache_slot *const cache_slots = protected_mem.cache_slots;
+static unsigned char (*const cache_data)[COFFEE_PAGE_SIZE] =
+  protected_mem.cache_data;
+static cfs_offset_t *const cache_next_offset =
+  &protected_mem.cache_next_offset;
+static uint8_t *const cache_victim = &protected_mem.cache_victim;
+static unsigned long cache_hits, cache_misses;
+#endif
+static struct cfs_coffee_gc_stats gc_stats;
+
+#if COFFEE_BACKGROUND_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+#endif
+
+#if COFFEE_READ_CACHE_PAGES
+/*---------------------------------------------------------------------------*/
+/* Drops the cached pages that overlap with a range of the storage. */
+static void
+invalidate_cache(cfs_offset_t offset, cfs_offset_t size)
+{
+  coffee_page_t first, last;
+  int i;
+
+  if(size == 0) {
+    return;
+  }
+
+  first = offset / COFFEE_PAGE_SIZE;
+  last = (offset + size - 1) / COFFEE_PAGE_SIZE;
+  for(i = 0; i < COFFEE_READ_CACHE_PAGES; i++) {
+    if(cache_slots[i].page >= first && cache_slots[i].page <= last) {
+      cache_slots[i].valid = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Loads a page and the pages that follow it into the cache. Returns the
+ * index of the slot of the page.
+ */
+static int
+load_cache(coffee_page_t page)
+{
+  coffee_page_t count;
+  int slot, i;
+
+  count = COFFEE_READ_AHEAD_PAGES;
+  if(count > COFFEE_PAGE_COUNT - page) {
+    count = COFFEE_PAGE_COUNT - page;
+  }
+
+  /* The pages are loaded into consecutive slots with a single read. */
+  if(*cache_victim + count > COFFEE_READ_CACHE_PAGES) {
+    *cache_victim = 0;
+  }
+  slot = *cache_victim;
+
+  /* Avoid keeping duplicates of pages that are cached already. */
+  invalidate_cache(page * COFFEE_PAGE_SIZE, count * COFFEE_PAGE_SIZE);
+
+  COFFEE_READ(cache_data[slot], count * COFFEE_PAGE_SIZE,
+              page * COFFEE_PAGE_SIZE);
+  for(i = 0; i < count; i++) {
+    cache_slots[slot + i].page = page + i;
+    cache_slots[slot + i].valid = 1;
+  }
+
+  *cache_victim = (slot + count) % COFFEE_READ_CACHE_PAGES;
+
+  return slot;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_cached(void *buf, unsigned size, cfs_offset_t offset)
+{
+  coffee_page_t page;
+  unsigned page_offset, n;
+  int slot;
+
+  if(size >= COFFEE_PAGE_SIZE) {
+    COFFEE_READ(buf, size, offset);
+    return;
+  }
+
+  while(size > 0) {
+    page = offset / COFFEE_PAGE_SIZE;
+    page_offset = offset % COFFEE_PAGE_SIZE;
+    n = COFFEE_PAGE_SIZE - page_offset;
+    if(n > size) {
+      n = size;
+    }
+
+    for(slot = 0; slot < COFFEE_READ_CACHE_PAGES; slot++) {
+      if(cache_slots[slot].valid && cache_slots[slot].page == page) {
+        break;
+      }
+    }
+    if(slot < COFFEE_READ_CACHE_PAGES) {
+      cache_hits++;
+      memcpy(buf, &cache_data[slot][page_offset], n);
+    } else {
+      cache_misses++;
+      if(offset == *cache_next_offset) {
+        slot = load_cache(page);
+        memcpy(buf, &cache_data[slot][page_offset], n);
+      } else {
+        COFFEE_READ(buf, n, offset);
+      }
+    }
+
+    *cache_next_offset = offset + n;
+    buf = (char *)buf + n;
+    offset += n;
+    size -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_flash(const void *buf, unsigned size, cfs_offset_t offset)
+{
+  invalidate_cache(offset, size);
+  COFFEE_WRITE(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+erase_flash(uint16_t sector)
+{
+  invalidate_cache((cfs_offset_t)sector * COFFEE_SECTOR_SIZE,
+                   COFFEE_SECTOR_SIZE);
+  COFFEE_ERASE(sector);
+}
+#endif /* COFFEE_READ_CACHE_PAGES */
 
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
 {
   hdr->flags |= HDR_FLAG_VALID;
-  COFFEE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  WRITE_FLASH(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -361,15 +638,19 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 }
 /*---------------------------------------------------------------------------*/
-static void
+/* Returns the number of erased sectors. */
+static unsigned
 collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
   coffee_page_t first_page, isolation_count;
+  unsigned erased;
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
-         mode == GC_RELUCTANT ? "reluctant" : "greedy");
+         mode == GC_RELUCTANT ? "reluctant" :
+         mode == GC_GREEDY ? "greedy" : "incremental");
+  erased = 0;
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
@@ -385,7 +666,7 @@ collect_garbage(int mode)
     }
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+       (mode != GC_RELUCTANT && stats.obsolete > 0)) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
       if(first_page < *next_free) {
         *next_free = first_page;
@@ -395,15 +676,51 @@ collect_garbage(int mode)
         isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
       }
 
-      COFFEE_ERASE(sector);
+      ERASE_FLASH(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+      erased++;
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
+      if((mode == GC_RELUCTANT && isolation_count > 0) ||
+         mode == GC_INCREMENTAL) {
         break;
       }
     }
   }
+
+  if(mode == GC_INCREMENTAL) {
+    gc_stats.background_sectors += erased;
+  } else {
+    gc_stats.foreground_runs++;
+    gc_stats.foreground_sectors += erased;
+  }
+
+  return erased;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static rtimer_clock_t start;
+  static unsigned erased;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    gc_stats.background_runs++;
+    start = RTIMER_NOW();
+    do {
+      erased = collect_garbage(GC_INCREMENTAL);
+    } while(erased > 0 &&
+            (rtimer_clock_t)(RTIMER_NOW() - start) < COFFEE_GC_BUDGET);
+    if(erased > 0) {
+      process_poll(&coffee_gc_process);
+    }
+  }
+
+  PROCESS_END();
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -426,6 +743,129 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_DIR_CACHE_SIZE
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = hash * 31 + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_add(const char *name, coffee_page_t page)
+{
+  uint16_t hash;
+  unsigned i;
+
+  if(*dir_cache_state == DIR_CACHE_UNBUILT) {
+    return;
+  }
+
+  /* One entry is always left free so that every probe sequence ends. */
+  if(*dir_cache_count >= COFFEE_DIR_CACHE_SIZE - 1) {
+    *dir_cache_state = DIR_CACHE_PARTIAL;
+    return;
+  }
+
+  hash = name_hash(name);
+  for(i = hash % COFFEE_DIR_CACHE_SIZE;
+      dir_cache[i].page != INVALID_PAGE;
+      i = (i + 1) % COFFEE_DIR_CACHE_SIZE);
+  dir_cache[i].page = page;
+  dir_cache[i].hash = hash;
+  (*dir_cache_count)++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_remove(const char *name, coffee_page_t page)
+{
+  unsigned i, j, home;
+
+  if(*dir_cache_state == DIR_CACHE_UNBUILT) {
+    return;
+  }
+
+  for(i = name_hash(name) % COFFEE_DIR_CACHE_SIZE;
+      dir_cache[i].page != page;
+      i = (i + 1) % COFFEE_DIR_CACHE_SIZE) {
+    if(dir_cache[i].page == INVALID_PAGE) {
+      return;
+    }
+  }
+  (*dir_cache_count)--;
+
+  /*
+   * Fill the hole with the next entry of the probe sequence that may
+   * move there, and repeat with the hole that this leaves. Entries that
+   * hash to a position after the hole must stay where they are.
+   */
+  for(;;) {
+    dir_cache[i].page = INVALID_PAGE;
+    j = i;
+    do {
+      j = (j + 1) % COFFEE_DIR_CACHE_SIZE;
+      if(dir_cache[j].page == INVALID_PAGE) {
+        return;
+      }
+      home = dir_cache[j].hash % COFFEE_DIR_CACHE_SIZE;
+    } while(i <= j ? (i < home && home <= j) : (i < home || home <= j));
+    dir_cache[i] = dir_cache[j];
+    i = j;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dir_cache_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  unsigned i;
+
+  for(i = 0; i < COFFEE_DIR_CACHE_SIZE; i++) {
+    dir_cache[i].page = INVALID_PAGE;
+  }
+  *dir_cache_count = 0;
+  *dir_cache_state = DIR_CACHE_COMPLETE;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      dir_cache_add(hdr.name, page);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coffee_page_t
+dir_cache_lookup(const char *name, struct file_header *hdr)
+{
+  uint16_t hash;
+  unsigned i;
+
+  if(*dir_cache_state == DIR_CACHE_UNBUILT) {
+    dir_cache_build();
+  }
+
+  hash = name_hash(name);
+  for(i = hash % COFFEE_DIR_CACHE_SIZE;
+      dir_cache[i].page != INVALID_PAGE;
+      i = (i + 1) % COFFEE_DIR_CACHE_SIZE) {
+    if(dir_cache[i].hash == hash) {
+      read_header(hdr, dir_cache[i].page);
+      if(HDR_ACTIVE(*hdr) && !HDR_LOG(*hdr) && strcmp(name, hdr->name) == 0) {
+        return dir_cache[i].page;
+      }
+    }
+  }
+  return INVALID_PAGE;
+}
+#endif /* COFFEE_DIR_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -464,6 +904,9 @@ load_file(coffee_page_t start, struct file_header *hdr)
   }
   /* We don't know the amount of records yet. */
   file->record_count = -1;
+#if COFFEE_EOF_RECORDS
+  file->eof_record = EOF_RECORD_NONE;
+#endif
 
   return file;
 }
@@ -487,6 +930,16 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_DIR_CACHE_SIZE
+  page = dir_cache_lookup(name, &hdr);
+  if(page != INVALID_PAGE) {
+    return load_file(page, &hdr);
+  }
+  if(*dir_cache_state == DIR_CACHE_COMPLETE) {
+    return NULL;
+  }
+#endif /* COFFEE_DIR_CACHE_SIZE */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -498,6 +951,82 @@ find_file(const char *name)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_EOF_RECORDS
+/* Returns the index of the last used end-of-file record, or -1. */
+static int
+last_eof_record(struct file_header *hdr)
+{
+  int i;
+
+  for(i = COFFEE_EOF_RECORDS - 1; i >= 0 && hdr->eof_records[i] == 0; i--);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Called before the file is written past its recorded end. */
+static void
+open_eof_record(struct file *file)
+{
+  struct file_header hdr;
+  int i;
+
+  if(file->eof_record != EOF_RECORD_NONE) {
+    return;
+  }
+
+  read_header(&hdr, file->page);
+  i = last_eof_record(&hdr) + 1;
+  if(HDR_EOF_LOST(hdr)) {
+    file->eof_record = EOF_RECORD_LOST;
+    return;
+  } else if(i < COFFEE_EOF_RECORDS) {
+    hdr.eof_records[i] = EOF_RECORD_OPEN;
+    file->eof_record = i;
+  } else {
+    hdr.flags |= HDR_FLAG_EOF_LOST;
+    file->eof_record = EOF_RECORD_LOST;
+  }
+  write_header(&hdr, file->page);
+}
+/*---------------------------------------------------------------------------*/
+/* Completes the open end-of-file record with the end of the file. */
+static void
+close_eof_record(struct file *file)
+{
+  struct file_header hdr;
+
+  if(file->eof_record == EOF_RECORD_NONE ||
+     file->eof_record == EOF_RECORD_LOST) {
+    return;
+  }
+
+  read_header(&hdr, file->page);
+  hdr.eof_records[file->eof_record] |= EOF_RECORD_DONE | file->end;
+  write_header(&hdr, file->page);
+  file->eof_record = EOF_RECORD_NONE;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Completes an end-of-file record that was left open when the system
+ * went down, with the end that a scan has found.
+ */
+static void
+recover_eof_record(struct file *file)
+{
+  struct file_header hdr;
+  int i;
+
+  read_header(&hdr, file->page);
+  i = last_eof_record(&hdr);
+  if(!HDR_EOF_LOST(hdr) && i >= 0 &&
+     !(hdr.eof_records[i] & EOF_RECORD_DONE)) {
+    PRINTF("Coffee: Recovered the end of the file at page %u\n",
+           (unsigned)file->page);
+    hdr.eof_records[i] |= EOF_RECORD_DONE | file->end;
+    write_header(&hdr, file->page);
+  }
+}
+#endif /* COFFEE_EOF_RECORDS */
+/*---------------------------------------------------------------------------*/
 static cfs_offset_t
 file_end(coffee_page_t start)
 {
@@ -508,6 +1037,15 @@ file_end(coffee_page_t start)
 
   read_header(&hdr, start);
 
+#if COFFEE_EOF_RECORDS
+  if(!HDR_EOF_LOST(hdr)) {
+    i = last_eof_record(&hdr);
+    if(i >= 0 && (hdr.eof_records[i] & EOF_RECORD_DONE)) {
+      return EOF_RECORD_END(hdr.eof_records[i]);
+    }
+  }
+#endif /* COFFEE_EOF_RECORDS */
+
   /*
    * Move from the end of the range towards the beginning and look for
    * a byte that has been modified.
@@ -588,8 +1126,19 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_DIR_CACHE_SIZE
+  if(!HDR_LOG(hdr)) {
+    dir_cache_remove(hdr.name, page);
+  }
+#endif
 
   *gc_wait = 0;
+#if COFFEE_BACKGROUND_GC
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+#endif
 
   /* Close all file descriptors that reference the removed file. */
   if(close_fds) {
@@ -608,7 +1157,7 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
     }
   }
 
-#if !COFFEE_EXTENDED_WEAR_LEVELLING
+#if !COFFEE_EXTENDED_WEAR_LEVELLING && !COFFEE_BACKGROUND_GC
   if(gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
@@ -653,7 +1202,15 @@ reserve(const char *name, coffee_page_t pages,
   strncpy(hdr.name, name, sizeof(hdr.name) - 1);
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
+#if COFFEE_EOF_RECORDS
+  hdr.eof_records[0] = EOF_RECORD_OPEN | EOF_RECORD_DONE;
+#endif
   write_header(&hdr, page);
+#if COFFEE_DIR_CACHE_SIZE
+  if(!HDR_LOG(hdr)) {
+    dir_cache_add(hdr.name, page);
+  }
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          pages, page, name);
@@ -721,7 +1278,7 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
       }
 
       base -= batch_size * sizeof(indices[0]);
-      COFFEE_READ(&indices, sizeof(indices[0]) * batch_size, base);
+      READ_CACHED(&indices, sizeof(indices[0]) * batch_size, base);
 
       for(i = batch_size - 1; i >= 0; i--) {
         if(indices[i] - 1 == region) {
@@ -762,7 +1319,7 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   base = absolute_offset(hdr->log_page, log_records * sizeof(region));
   base += (cfs_offset_t)match_index * log_record_size;
   base += lp->offset;
-  COFFEE_READ(lp->buf, lp->size, base);
+  READ_CACHED(lp->buf, lp->size, base);
 
   return lp->size;
 }
@@ -832,11 +1389,24 @@ merge_log(coffee_page_t file_page, int extend)
       cfs_close(fd);
       return -1;
     } else if(n > 0) {
-      COFFEE_WRITE(buf, n, absolute_offset(new_file->page, offset));
+      WRITE_FLASH(buf, n, absolute_offset(new_file->page, offset));
       offset += n;
     }
   } while(n != 0);
 
+  /*
+   * Copy the log configuration and record the end of the copied data
+   * before the old file is removed, so that the data has a valid end
+   * in either file if the system goes down in between.
+   */
+  read_header(&hdr2, new_file->page);
+  hdr2.log_record_size = hdr.log_record_size;
+  hdr2.log_records = hdr.log_records;
+#if COFFEE_EOF_RECORDS
+  hdr2.eof_records[0] |= offset;
+#endif
+  write_header(&hdr2, new_file->page);
+
   for(i = 0; i < COFFEE_FD_SET_SIZE; i++) {
     if(coffee_fd_set[i].flags != COFFEE_FD_FREE &&
        coffee_fd_set[i].file->page == file_page) {
@@ -851,12 +1421,6 @@ merge_log(coffee_page_t file_page, int extend)
     return -1;
   }
 
-  /* Copy the log configuration and the EOF hint. */
-  read_header(&hdr2, new_file->page);
-  hdr2.log_record_size = hdr.log_record_size;
-  hdr2.log_records = hdr.log_records;
-  write_header(&hdr2, new_file->page);
-
   new_file->flags &= ~COFFEE_FILE_MODIFIED;
   new_file->end = offset;
 
@@ -965,11 +1529,11 @@ write_log_page(struct file *file, struct log_param *lp)
      */
     offset = absolute_offset(log_page, 0);
     ++region;
-    COFFEE_WRITE(&region, sizeof(region),
+    WRITE_FLASH(&region, sizeof(region),
                  offset + log_record * sizeof(region));
 
     offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
+    WRITE_FLASH(copy_buf, sizeof(copy_buf),
                  offset + log_record * log_record_size);
     file->record_count = log_record + 1;
   }
@@ -1018,6 +1582,9 @@ cfs_open(const char *name, int flags)
     fdp->file->end = 0;
   } else if(fdp->file->end == UNKNOWN_OFFSET) {
     fdp->file->end = file_end(fdp->file->page);
+#if COFFEE_EOF_RECORDS
+    recover_eof_record(fdp->file);
+#endif
   }
 
   fdp->flags |= flags;
@@ -1031,6 +1598,11 @@ void
 cfs_close(int fd)
 {
   if(FD_VALID(fd)) {
+#if COFFEE_EOF_RECORDS
+    if(FD_WRITABLE(fd) || coffee_fd_set[fd].file->references == 1) {
+      close_eof_record(coffee_fd_set[fd].file);
+    }
+#endif
     coffee_fd_set[fd].flags = COFFEE_FD_FREE;
     coffee_fd_set[fd].file->references--;
     coffee_fd_set[fd].file = NULL;
@@ -1063,6 +1635,9 @@ cfs_seek(int fd, cfs_offset_t offset, int whence)
   }
 
   if(fdp->file->end < new_offset) {
+#if COFFEE_EOF_RECORDS
+    open_eof_record(fdp->file);
+#endif
     fdp->file->end = new_offset;
   }
 
@@ -1112,7 +1687,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
   /* If the file is allocated, read directly in the file. */
   if(!FILE_MODIFIED(file)) {
-    COFFEE_READ(buf, size, absolute_offset(file->page, fdp->offset));
+    READ_CACHED(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
     return size;
   }
@@ -1132,7 +1707,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
-      COFFEE_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
+      READ_CACHED(buf, lp.size, absolute_offset(file->page, fdp->offset));
       r = lp.size;
     }
     fdp->offset += r;
@@ -1179,6 +1754,12 @@ cfs_write(int fd, const void *buf, unsigned size)
 }
 #endif
 
+#if COFFEE_EOF_RECORDS
+  if(fdp->offset + size > file->end) {
+    open_eof_record(file);
+  }
+#endif
+
 #if COFFEE_MICRO_LOGS
 #if COFFEE_IO_SEMANTICS
   if(!(fdp->io_flags & CFS_COFFEE_IO_FLASH_AWARE) &&
@@ -1201,6 +1782,11 @@ cfs_write(int fd, const void *buf, unsigned size)
       } else if(i == 0) {
         /* The file was merged with the log. */
         file = fdp->file;
+#if COFFEE_EOF_RECORDS
+        if(fdp->offset + bytes_left > file->end) {
+          open_eof_record(file);
+        }
+#endif
       } else {
         /* A log record was written. */
         bytes_left -= i;
@@ -1223,7 +1809,7 @@ cfs_write(int fd, const void *buf, unsigned size)
        * corresponding end offset in the original extent to ensure that
        * the correct file size is calculated when opening the file again.
        */
-      COFFEE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
+      WRITE_FLASH(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
     }
   } else {
 #endif /* COFFEE_MICRO_LOGS */
@@ -1233,7 +1819,7 @@ cfs_write(int fd, const void *buf, unsigned size)
   }
 #endif /* COFFEE_APPEND_ONLY */
 
-  COFFEE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
+  WRITE_FLASH(buf, size, absolute_offset(file->page, fdp->offset));
   fdp->offset += size;
 #if COFFEE_MICRO_LOGS
 }
@@ -1349,7 +1935,7 @@ cfs_coffee_format(void)
   *next_free = 0;
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
-    COFFEE_ERASE(i);
+    ERASE_FLASH(i);
     PRINTF(".");
   }
 
@@ -1367,3 +1953,18 @@ cfs_coffee_get_protected_mem(unsigned *size)
   *size = sizeof(protected_mem);
   return &protected_mem;
 }
+/*---------------------------------------------------------------------------*/
+void
+cfs_coffee_get_gc_stats(struct cfs_coffee_gc_stats *stats)
+{
+  *stats = gc_stats;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_READ_CACHE_PAGES
+void
+cfs_coffee_get_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+  *hits = cache_hits;
+  *misses = cache_misses;
+}
+#endif /* COFFEE_READ_CACHE_PAGES */
@@ -138,6 +138,39 @@ int cfs_coffee_format(void);
  */
 void *cfs_coffee_get_protected_mem(unsigned *size);
 
+/**
+ * \brief Get the counters of the read cache.
+ * \param hits The number of page accesses served by the cache.
+ * \param misses The number of page accesses that loaded pages.
+ *
+ * Only available when Coffee is configured with a read cache through
+ * COFFEE_READ_CACHE_PAGES.
+ */
+void cfs_coffee_get_cache_stats(unsigned long *hits, unsigned long *misses);
+
+/**
+ * Garbage collection statistics.
+ */
+struct cfs_coffee_gc_stats {
+  /** Collections run synchronously by file system operations. */
+  unsigned long foreground_runs;
+  /** Sectors erased by these collections. */
+  unsigned long foreground_sectors;
+  /** Runs of the background garbage collection process. */
+  unsigned long background_runs;
+  /** Sectors erased by the background garbage collection. */
+  unsigned long background_sectors;
+};
+
+/**
+ * \brief Get the garbage collection statistics.
+ * \param stats The structure to copy the statistics to.
+ *
+ * Background garbage collection is enabled through
+ * COFFEE_BACKGROUND_GC.
+ */
+void cfs_coffee_get_gc_stats(struct cfs_coffee_gc_stats *stats);
+
 /** @} */
 /** @} */
 
@@ -79,4 +79,16 @@ void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
 extern const struct aes_128_driver AES_128;
 
+/**
+ * The byte-oriented software implementation, which AES_128 defaults to.
+ */
+extern const struct aes_128_driver aes_128_driver;
+
+/**
+ * AES-128 with a 32-bit T-table. Much faster than aes_128_driver on
+ * 32- and 64-bit CPUs, at the cost of 1 KB of constant data. Select it
+ * with AES_128_CONF.
+ */
+extern const struct aes_128_driver aes_128_ttable_driver;
+
 #endif /* AES_H_ */
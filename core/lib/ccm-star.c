@@ -59,33 +59,14 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* Starts the CBC-MAC in x with B_0 and the additional authenticated data */
 static void
-ctr_step(const uint8_t *nonce,
-    uint8_t pos,
-    uint8_t *m_and_result,
+mic_start(uint8_t *x,
+    const uint8_t *nonce,
     uint8_t m_len,
-    uint8_t counter)
-{
-  uint8_t a[AES_128_BLOCK_SIZE];
-  uint8_t i;
-  
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
-  }
-}
-/*---------------------------------------------------------------------------*/
-static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint8_t m_len,
     const uint8_t *a, uint8_t a_len,
-    uint8_t *result,
     uint8_t mic_len)
 {
-  uint8_t x[AES_128_BLOCK_SIZE];
   uint8_t pos;
   uint8_t i;
   
@@ -109,35 +90,6 @@ mic(const uint8_t *nonce,
       AES_128.encrypt(x);
     }
   }
-  
-  if(m_len) {
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
-  }
-  
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-  
-  memcpy(result, x, mic_len);
-}
-/*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
-{
-  uint8_t pos;
-  uint8_t counter;
-  
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-    pos += AES_128_BLOCK_SIZE;
-  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -146,6 +98,11 @@ set_key(const uint8_t *key)
   AES_128.set_key(key);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Authenticates and en- or decrypts m in a single pass: each block of m
+ * is fed into the CBC-MAC as plaintext and XORed with its keystream
+ * block K_{counter} right away.
+ */
 static void
 aead(const uint8_t* nonce,
     uint8_t* m, uint8_t m_len,
@@ -153,20 +110,41 @@ aead(const uint8_t* nonce,
     uint8_t *result, uint8_t mic_len,
     int forward)
 {
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
-  }
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t ctr[AES_128_BLOCK_SIZE];
+  uint8_t k[AES_128_BLOCK_SIZE];
+  uint8_t pos;
+  uint8_t len;
+  uint8_t i;
+  
+  mic_start(x, nonce, m_len, a, a_len, mic_len);
+  set_iv(ctr, CCM_STAR_ENCRYPTION_FLAGS, nonce, 0);
   
-  mic(nonce,
-    m, m_len,
-    a, a_len,
-    result,
-    mic_len);
+  for(pos = 0; pos < m_len; pos += len) {
+    len = MIN(m_len - pos, AES_128_BLOCK_SIZE);
+    ctr[15]++;
+    memcpy(k, ctr, AES_128_BLOCK_SIZE);
+    AES_128.encrypt(k);
+    
+    if(forward) {
+      for(i = 0; i < len; i++) {
+        x[i] ^= m[pos + i];
+        m[pos + i] ^= k[i];
+      }
+    } else {
+      for(i = 0; i < len; i++) {
+        m[pos + i] ^= k[i];
+        x[i] ^= m[pos + i];
+      }
+    }
+    AES_128.encrypt(x);
+  }
   
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  /* the MIC is the CBC-MAC encrypted with K_0 */
+  ctr[15] = 0;
+  AES_128.encrypt(ctr);
+  for(i = 0; i < mic_len; i++) {
+    result[i] = x[i] ^ ctr[i];
   }
 }
 /*---------------------------------------------------------------------------*/
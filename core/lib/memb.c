@@ -53,25 +53,89 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = m->num;
+  m->fresh = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  m->used = 0;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  m->max_used = 0;
+  m->failed = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_FREELIST
+static int
+block_index(struct memb *m, void *ptr)
+{
+  unsigned long offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (unsigned long)((char *)ptr - (char *)m->mem);
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  return offset / m->size;
+}
+#endif /* MEMB_FREELIST */
+/*---------------------------------------------------------------------------*/
 void *
 memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_FREELIST
+  void *ptr;
+
+  if(m->free < m->num) {
+    /* Reuse the most recently freed block. */
+    i = m->free;
+    m->free = m->next[i];
+    ptr = (char *)m->mem + (i * m->size);
+  } else if(m->fresh < m->num) {
+    /* Hand out a block that has never been used. */
+    i = m->fresh++;
+    ptr = (char *)m->mem + (i * m->size);
+  } else {
+    ptr = NULL;
+  }
+
+  if(ptr != NULL) {
+    m->count[i] = 1;
+    ++(m->used);
+#if MEMB_STATS
+    if(m->used > m->max_used) {
+      m->max_used = m->used;
+    }
+#endif /* MEMB_STATS */
+    return ptr;
+  }
+#else /* MEMB_FREELIST */
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
       /* If this block was unused, we increase the reference count to
 	 indicate that it now is used and return a pointer to the
 	 memory block. */
       ++(m->count[i]);
+#if MEMB_STATS
+      if(++(m->used) > m->max_used) {
+        m->max_used = m->used;
+      }
+#endif /* MEMB_STATS */
       return (void *)((char *)m->mem + (i * m->size));
     }
   }
+#endif /* MEMB_FREELIST */
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_STATS
+  ++(m->failed);
+#endif /* MEMB_STATS */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -79,6 +143,23 @@ char
 memb_free(struct memb *m, void *ptr)
 {
   int i;
+#if MEMB_FREELIST
+
+  /* The block index follows directly from the pointer. */
+  i = block_index(m, ptr);
+  if(i < 0) {
+    return -1;
+  }
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    if(--(m->count[i]) == 0) {
+      m->next[i] = m->free;
+      m->free = i;
+      --(m->used);
+    }
+  }
+  return m->count[i];
+#else /* MEMB_FREELIST */
   char *ptr2;
 
   /* Walk through the list of blocks and try to find the block to
@@ -92,12 +173,18 @@ memb_free(struct memb *m, void *ptr)
       if(m->count[i] > 0) {
 	/* Make sure that we don't deallocate free memory. */
 	--(m->count[i]);
+#if MEMB_STATS
+        if(m->count[i] == 0) {
+          --(m->used);
+        }
+#endif /* MEMB_STATS */
       }
       return m->count[i];
     }
     ptr2 += m->size;
   }
   return -1;
+#endif /* MEMB_FREELIST */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,6 +197,9 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREELIST
+  return m->num - m->used;
+#else /* MEMB_FREELIST */
   int i;
   int num_free = 0;
 
@@ -120,5 +210,6 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREELIST */
 }
 /** @} */
@@ -65,6 +65,44 @@
 
 #include "sys/cc.h"
 
+/**
+ * \brief Use a free list for constant time allocation
+ *
+ *        With MEMB_CONF_FREELIST set, unused blocks are threaded on a
+ *        free list, so that memb_alloc(), memb_free() and
+ *        memb_numfree() run in constant time instead of scanning the
+ *        whole block. The links of the list are kept in an index
+ *        array next to the reference counts, not in the blocks, so a
+ *        freed block keeps its contents.
+ */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+/**
+ * \brief Keep allocation statistics for each memory block
+ *
+ *        With MEMB_CONF_STATS set, each memory block records the
+ *        highest number of blocks that have been in use at once
+ *        (max_used) and the number of failed allocations (failed).
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+#if MEMB_FREELIST
+#define MEMB_NEXT(name, num) \
+        static unsigned short CC_CONCAT(name,_memb_next)[num];
+#define MEMB_NEXT_PTR(name) , CC_CONCAT(name,_memb_next)
+#else /* MEMB_FREELIST */
+#define MEMB_NEXT(name, num)
+#define MEMB_NEXT_PTR(name)
+#endif /* MEMB_FREELIST */
+
 /**
  * Declare a memory block.
  *
@@ -88,16 +126,34 @@ MEMB(connections, struct connection, 16);
  */
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
+        MEMB_NEXT(name, num) \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_NEXT_PTR(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREELIST
+  /* Index of the next freed block, for each freed block */
+  unsigned short *next;
+  /* Index of the most recently freed block, or num if none. */
+  unsigned short free;
+  /* Index of the first block that has never been allocated. Blocks
+     from this index onwards are not on the free list. */
+  unsigned short fresh;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  unsigned short used;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  unsigned short max_used;
+  unsigned short failed;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -49,15 +49,224 @@
 #include "contiki-conf.h"
 #include <string.h>
 
+#if MMEM_LAZY_COMPACTION
+#include "sys/process.h"
+#endif /* MMEM_LAZY_COMPACTION */
+
 #ifdef MMEM_CONF_SIZE
 #define MMEM_SIZE MMEM_CONF_SIZE
 #else
 #define MMEM_SIZE 4096
 #endif
 
-LIST(mmemlist);
+#ifdef MMEM_CONF_BINS
+#define MMEM_BINS MMEM_CONF_BINS
+#else
+#define MMEM_BINS 8
+#endif
+
+/* The number of bytes the mmem process moves each time it runs. */
+#ifdef MMEM_CONF_COMPACT_BUDGET
+#define MMEM_COMPACT_BUDGET MMEM_CONF_COMPACT_BUDGET
+#else
+#define MMEM_COMPACT_BUDGET 256
+#endif
+
 unsigned int avail_memory;
-static char memory[MMEM_SIZE];
+static unsigned long moved;
+
+#if MMEM_LAZY_COMPACTION
+/*
+ * Allocated blocks are kept on a doubly linked list sorted by
+ * address. The free space between two blocks is a hole. Holes that
+ * are large enough to hold a struct hole keep one at their start and
+ * are put on the free list of their size class; smaller holes are
+ * only reclaimed by compaction. The free space after the last block
+ * is the top of the memory and is never on a free list.
+ */
+struct hole {
+  struct hole *next;
+  struct hole *prev;
+  /* The block just below the hole, or NULL at the bottom. */
+  struct mmem *owner;
+  unsigned int size;
+};
+
+#define ALIGN_SIZE(s) (((s) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define FOOTPRINT(m)  ALIGN_SIZE((m)->size)
+#define HOLE_MIN      ALIGN_SIZE(sizeof(struct hole))
+
+static union {
+  char bytes[MMEM_SIZE];
+  void *align;
+} heap;
+#define memory heap.bytes
+
+static struct mmem *first, *last;
+static char *top;
+static struct hole *bins[MMEM_BINS];
+
+PROCESS(mmem_process, "Managed memory");
+#else /* MMEM_LAZY_COMPACTION */
+LIST(mmemlist);
+/* Aligned so that blocks of aligned sizes stay aligned */
+static union {
+  char bytes[MMEM_SIZE];
+  void *align;
+} heap;
+#define memory heap.bytes
+#endif /* MMEM_LAZY_COMPACTION */
+
+#if MMEM_LAZY_COMPACTION
+/*---------------------------------------------------------------------------*/
+static char *
+block_end(struct mmem *m)
+{
+  return (char *)m->ptr + FOOTPRINT(m);
+}
+/*---------------------------------------------------------------------------*/
+static char *
+gap_start(struct mmem *below)
+{
+  return below == NULL ? memory : block_end(below);
+}
+/*---------------------------------------------------------------------------*/
+static struct mmem *
+block_above(struct mmem *below)
+{
+  return below == NULL ? first : below->next;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bin_index(unsigned int size)
+{
+  int i;
+
+  for(i = 0; i < MMEM_BINS - 1 && size >= (HOLE_MIN << (i + 1)); i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hole_add(char *start, unsigned int size, struct mmem *owner)
+{
+  struct hole *h;
+  int i;
+
+  if(size < HOLE_MIN) {
+    return;
+  }
+  h = (struct hole *)start;
+  h->owner = owner;
+  h->size = size;
+  i = bin_index(size);
+  h->prev = NULL;
+  h->next = bins[i];
+  if(h->next != NULL) {
+    h->next->prev = h;
+  }
+  bins[i] = h;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hole_unlink(struct hole *h)
+{
+  if(h->prev != NULL) {
+    h->prev->next = h->next;
+  } else {
+    bins[bin_index(h->size)] = h->next;
+  }
+  if(h->next != NULL) {
+    h->next->prev = h->prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Take the hole above the block "below" off its free list, if it has
+   one. */
+static void
+hole_remove(struct mmem *below)
+{
+  struct mmem *above;
+  char *start;
+
+  above = block_above(below);
+  if(above == NULL) {
+    return;
+  }
+  start = gap_start(below);
+  if((char *)above->ptr - start >= HOLE_MIN) {
+    hole_unlink((struct hole *)start);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct hole *
+hole_find(unsigned int size)
+{
+  struct hole *h;
+  int i;
+
+  for(i = bin_index(size); i < MMEM_BINS; i++) {
+    for(h = bins[i]; h != NULL; h = h->next) {
+      if(h->size >= size) {
+        return h;
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+block_link(struct mmem *m, struct mmem *below)
+{
+  m->prev = below;
+  m->next = block_above(below);
+  if(m->next != NULL) {
+    m->next->prev = m;
+  } else {
+    last = m;
+  }
+  if(below != NULL) {
+    below->next = m;
+  } else {
+    first = m;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+block_unlink(struct mmem *m)
+{
+  if(m->prev != NULL) {
+    m->prev->next = m->next;
+  } else {
+    first = m->next;
+  }
+  if(m->next != NULL) {
+    m->next->prev = m->prev;
+  } else {
+    last = m->prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+fragmented(void)
+{
+  return (unsigned int)(memory + MMEM_SIZE - top) != avail_memory;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    mmem_compact(MMEM_COMPACT_BUDGET);
+    if(fragmented()) {
+      process_poll(&mmem_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* MMEM_LAZY_COMPACTION */
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -82,6 +291,46 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+#if MMEM_LAZY_COMPACTION
+  struct hole *h;
+  struct mmem *below;
+  unsigned int footprint;
+  unsigned int hole_size;
+
+  footprint = ALIGN_SIZE(size);
+  if(avail_memory < footprint) {
+    return 0;
+  }
+
+  h = hole_find(footprint);
+  if(h != NULL) {
+    /* Put the block at the start of the hole and give what is left of
+       the hole back to the free lists. */
+    below = h->owner;
+    hole_size = h->size;
+    hole_unlink(h);
+    m->ptr = h;
+    m->size = size;
+    block_link(m, below);
+    hole_add((char *)m->ptr + footprint, hole_size - footprint, m);
+  } else {
+    if((unsigned int)(memory + MMEM_SIZE - top) < footprint) {
+      /* The free memory is scattered over holes that are too small,
+         so we have to compact it all now. */
+      mmem_compact(MMEM_SIZE);
+      if((unsigned int)(memory + MMEM_SIZE - top) < footprint) {
+        return 0;
+      }
+    }
+    m->ptr = top;
+    m->size = size;
+    block_link(m, last);
+    top += footprint;
+  }
+
+  avail_memory -= footprint;
+  return 1;
+#else /* MMEM_LAZY_COMPACTION */
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
     return 0;
@@ -104,6 +353,7 @@ mmem_alloc(struct mmem *m, unsigned int size)
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
+#endif /* MMEM_LAZY_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -120,12 +370,30 @@ mmem_free(struct mmem *m)
 {
   struct mmem *n;
 
+#if MMEM_LAZY_COMPACTION
+  /* Merge the holes below and above the block with the block
+     itself. */
+  hole_remove(m->prev);
+  hole_remove(m);
+  block_unlink(m);
+  avail_memory += FOOTPRINT(m);
+
+  n = block_above(m->prev);
+  if(n == NULL) {
+    top = gap_start(m->prev);
+  } else {
+    hole_add(gap_start(m->prev), (char *)n->ptr - gap_start(m->prev),
+             m->prev);
+    process_poll(&mmem_process);
+  }
+#else /* MMEM_LAZY_COMPACTION */
   if(m->next != NULL) {
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
     memmove(m->ptr, m->next->ptr,
 	    &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr);
-    
+    moved += &memory[MMEM_SIZE - avail_memory] - (char *)m->next->ptr;
+
     /* Update all the memory pointers that points to memory that is
        after the allocation that is to be removed. */
     for(n = m->next; n != NULL; n = n->next) {
@@ -137,6 +405,7 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_LAZY_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -155,10 +424,99 @@ mmem_init(void)
   if(inited) {
     return;
   }
+#if MMEM_LAZY_COMPACTION
+  first = last = NULL;
+  top = memory;
+  memset(bins, 0, sizeof(bins));
+  process_start(&mmem_process, NULL);
+#else /* MMEM_LAZY_COMPACTION */
   list_init(mmemlist);
+#endif /* MMEM_LAZY_COMPACTION */
   avail_memory = MMEM_SIZE;
+  moved = 0;
   inited = 1;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ * \param budget The number of bytes that may be moved
+ * \return     The number of bytes that were moved
+ *
+ *             This function moves allocated blocks downwards into
+ *             the holes left by mmem_free() until at least budget
+ *             bytes have been moved or no holes are left. Without
+ *             MMEM_CONF_LAZY_COMPACTION the memory is always compact
+ *             and this function does nothing.
+ *
+ */
+unsigned int
+mmem_compact(unsigned int budget)
+{
+#if MMEM_LAZY_COMPACTION
+  struct mmem *below;
+  struct mmem *m;
+  char *dst;
+  unsigned int count;
+
+  count = 0;
+  below = NULL;
+  for(m = first; m != NULL && count < budget; below = m, m = m->next) {
+    dst = gap_start(below);
+    if(dst == (char *)m->ptr) {
+      continue;
+    }
+
+    /* Slide the block down to the end of the block below it, which
+       merges the hole below it with the one above it. */
+    hole_remove(below);
+    hole_remove(m);
+    memmove(dst, m->ptr, FOOTPRINT(m));
+    m->ptr = dst;
+    if(m->next == NULL) {
+      top = block_end(m);
+    } else {
+      hole_add(block_end(m), (char *)m->next->ptr - block_end(m), m);
+    }
+    count += FOOTPRINT(m);
+  }
+  moved += count;
+  return count;
+#else /* MMEM_LAZY_COMPACTION */
+  return 0;
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get fragmentation statistics for the managed memory
+ * \param stats A pointer to a struct mmem_stats that is filled in
+ *
+ */
+void
+mmem_get_stats(struct mmem_stats *stats)
+{
+#if MMEM_LAZY_COMPACTION
+  struct mmem *m;
+  unsigned int gap;
+
+  stats->free = avail_memory;
+  stats->largest = memory + MMEM_SIZE - top;
+  stats->holes = 0;
+  for(m = first; m != NULL; m = m->next) {
+    gap = (char *)m->ptr - gap_start(m->prev);
+    if(gap > 0) {
+      stats->holes++;
+      if(gap > stats->largest) {
+        stats->largest = gap;
+      }
+    }
+  }
+#else /* MMEM_LAZY_COMPACTION */
+  stats->free = avail_memory;
+  stats->largest = avail_memory;
+  stats->holes = 0;
+#endif /* MMEM_LAZY_COMPACTION */
+  stats->moved = moved;
+}
+/*---------------------------------------------------------------------------*/
 
 /** @} */
@@ -59,6 +59,25 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
+/**
+ * \brief Defer compaction to a background process
+ *
+ *        By default, mmem_free() compacts the memory immediately by
+ *        moving all later allocations downwards. With
+ *        MMEM_CONF_LAZY_COMPACTION set, freed memory is instead kept
+ *        as holes that are reused by mmem_alloc() through a set of
+ *        segregated size-class free lists. The holes are compacted
+ *        incrementally by the mmem process, and synchronously only
+ *        when an allocation would otherwise fail.
+ */
+#ifdef MMEM_CONF_LAZY_COMPACTION
+#define MMEM_LAZY_COMPACTION MMEM_CONF_LAZY_COMPACTION
+#else /* MMEM_CONF_LAZY_COMPACTION */
+#define MMEM_LAZY_COMPACTION 0
+#endif /* MMEM_CONF_LAZY_COMPACTION */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -78,6 +97,24 @@ struct mmem {
   struct mmem *next;
   unsigned int size;
   void *ptr;
+#if MMEM_LAZY_COMPACTION
+  struct mmem *prev;
+#endif /* MMEM_LAZY_COMPACTION */
+};
+
+/**
+ * Fragmentation statistics of the managed memory, as returned by
+ * mmem_get_stats().
+ */
+struct mmem_stats {
+  /** Total number of free bytes. */
+  unsigned int free;
+  /** Size of the largest contiguous free region. */
+  unsigned int largest;
+  /** Number of free regions between allocated blocks. */
+  unsigned int holes;
+  /** Number of bytes moved by compaction since mmem_init(). */
+  unsigned long moved;
 };
 
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
@@ -86,6 +123,8 @@ struct mmem {
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_get_stats(struct mmem_stats *stats);
+unsigned int mmem_compact(unsigned int budget);
 
 #endif /* MMEM_H_ */
 
@@ -55,6 +55,47 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+/* With the send window, the output buffer holds everything from the
+   oldest unacknowledged byte onwards and uIP tells us which part of
+   it to send next. */
+static void
+senddata(struct tcp_socket *s)
+{
+  uint16_t off = uip_sendoffset();
+  int len = MIN(s->output_data_max_seg, uip_sendlimit());
+
+  if(s->output_data_len > off && len > 0) {
+    len = MIN(s->output_data_len - off, len);
+    uip_send(&s->output_data_ptr[off], len);
+    if(s->output_data_len > off + len) {
+      /* Come back for the next segment while the window allows. */
+      tcpip_poll_tcp(uip_conn);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+acked(struct tcp_socket *s)
+{
+  uint16_t len = uip_ackedlen();
+
+  if(len > s->output_data_len) {
+    printf("tcp: acked assertion failed s->output_data_len (%d) < acked (%d)\n",
+           s->output_data_len, len);
+    tcp_markconn(uip_conn, NULL);
+    uip_abort();
+    call_event(s, TCP_SOCKET_ABORTED);
+    relisten(s);
+    return;
+  }
+  memmove(&s->output_data_ptr[0], &s->output_data_ptr[len],
+          s->output_data_len - len);
+  s->output_data_len -= len;
+
+  call_event(s, TCP_SOCKET_DATA_SENT);
+}
+#else /* UIP_TCP_SEND_WINDOW */
 static void
 senddata(struct tcp_socket *s)
 {
@@ -96,6 +137,7 @@ acked(struct tcp_socket *s)
     call_event(s, TCP_SOCKET_DATA_SENT);
   }
 }
+#endif /* UIP_TCP_SEND_WINDOW */
 /*---------------------------------------------------------------------------*/
 static void
 newdata(struct tcp_socket *s)
@@ -162,6 +204,11 @@ appcall(void *state)
 	   s->listen_port == uip_htons(uip_conn->lport)) {
 	  s->flags &= ~TCP_SOCKET_FLAGS_LISTENING;
           s->output_data_max_seg = uip_mss();
+#if UIP_TCP_SEND_WINDOW
+          uip_enable_window(uip_conn);
+          /* tcp_socket_send() polls s->c to start sending. */
+	  s->c = uip_conn;
+#endif /* UIP_TCP_SEND_WINDOW */
 	  tcp_markconn(uip_conn, s);
 	  call_event(s, TCP_SOCKET_CONNECTED);
 	  break;
@@ -302,6 +349,9 @@ tcp_socket_connect(struct tcp_socket *s,
   if(s->c == NULL) {
     return -1;
   } else {
+#if UIP_TCP_SEND_WINDOW
+    uip_enable_window(s->c);
+#endif /* UIP_TCP_SEND_WINDOW */
     return 1;
   }
 }
@@ -356,6 +406,16 @@ tcp_socket_send(struct tcp_socket *s,
     s->output_senddata_len = s->output_data_len;
   }
 
+#if UIP_TCP_SEND_WINDOW
+  /* If the buffer was empty, nothing is in flight to bring back an
+     ACK, so start sending now rather than at the next periodic
+     poll. */
+  if(len > 0 && s->output_data_len == len && s->c != NULL &&
+     (s->c->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+    tcpip_poll_tcp(s->c);
+  }
+#endif /* UIP_TCP_SEND_WINDOW */
+
   return len;
 }
 /*---------------------------------------------------------------------------*/
@@ -401,7 +401,7 @@ eventhandler(process_event_t ev, process_data_t data)
         for(cptr = &uip_udp_conns[0];
             cptr < &uip_udp_conns[UIP_UDP_CONNS]; ++cptr) {
           if(cptr->appstate.p == p) {
-            cptr->lport = 0;
+            uip_udp_remove(cptr);
           }
         }
       }
@@ -648,24 +648,23 @@ tcpip_ipv6_output(void)
         uip_clear_buf();
         return;
       } else {
-#if UIP_CONF_IPV6_QUEUE_PKT
-        /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
-#endif
       /* RFC4861, 7.2.2:
        * "If the source address of the packet prompting the solicitation is the
        * same as one of the addresses assigned to the outgoing interface, that
        * address SHOULD be placed in the IP Source Address of the outgoing
        * solicitation.  Otherwise, any one of the addresses assigned to the
        * interface should be used."*/
-       if(uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr)){
-          uip_nd6_ns_output(&UIP_IP_BUF->srcipaddr, NULL, &nbr->ipaddr);
-        } else {
-          uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
+        uip_ipaddr_t *src = NULL;
+
+        if(uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr)) {
+          src = &UIP_IP_BUF->srcipaddr;
         }
+#if UIP_CONF_IPV6_QUEUE_PKT
+        /* Queue outgoing pkt for later transmit. With a packet pool this
+           parks the buffer src points into and gives uip_buf a new one. */
+        uip_packetqueue_save(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME);
+#endif
+        uip_nd6_ns_output(src, NULL, &nbr->ipaddr);
 
         stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
         nbr->nscount = 1;
@@ -680,12 +679,8 @@ tcpip_ipv6_output(void)
       if(nbr->state == NBR_INCOMPLETE) {
         PRINTF("tcpip_ipv6_output: nbr cache entry incomplete\n");
 #if UIP_CONF_IPV6_QUEUE_PKT
-        /* Copy outgoing pkt in the queuing buffer for later transmit and set
-           the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        /* Queue outgoing pkt for later transmit to nbr. */
+        uip_packetqueue_save(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_clear_buf();
         return;
@@ -709,10 +704,7 @@ tcpip_ipv6_output(void)
        * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
        * to STALE, and you must both send a NA and the queued packet.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-        uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-        memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
+      if(uip_packetqueue_restore(&nbr->packethandle)) {
         tcpip_output(uip_ds6_nbr_get_ll(nbr));
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
@@ -791,6 +783,9 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+  /* Packet processing goes before application events. */
+  process_set_priority(&tcpip_process, PROCESS_PRIORITY_HIGH);
   
 #if UIP_TCP
  {
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         A pool of uIP packet buffers
+ */
+
+#include "net/ip/uip-packetpool.h"
+#include "lib/memb.h"
+
+#if UIP_PACKET_POOL
+
+#if UIP_PACKET_POOL < 2
+#error "UIP_CONF_PACKET_POOL must be at least 2"
+#endif
+
+uip_buf_t *uip_bufp = &uip_aligned_buf;
+
+/* uip_aligned_buf is the first buffer of the pool, the others come
+   from a memb. It starts out as the current buffer. */
+MEMB(bufs_memb, uip_buf_t, UIP_PACKET_POOL - 1);
+static uint8_t aligned_buf_free;
+
+extern void *uip_sappdata;
+/*---------------------------------------------------------------------------*/
+static void *
+rebase(void *ptr, uip_buf_t *from, uip_buf_t *to)
+{
+  if((uint8_t *)ptr >= from->u8 && (uint8_t *)ptr < from->u8 + UIP_BUFSIZE) {
+    return to->u8 + ((uint8_t *)ptr - from->u8);
+  }
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_current(uip_buf_t *buf)
+{
+  /* The application data pointers follow uip_buf, as they would if
+     the packet had been copied into it. */
+  uip_appdata = rebase(uip_appdata, uip_bufp, buf);
+  uip_sappdata = rebase(uip_sappdata, uip_bufp, buf);
+  uip_bufp = buf;
+}
+/*---------------------------------------------------------------------------*/
+uip_buf_t *
+uip_packetpool_alloc(void)
+{
+  uip_buf_t *buf;
+
+  buf = memb_alloc(&bufs_memb);
+  if(buf == NULL && aligned_buf_free) {
+    aligned_buf_free = 0;
+    buf = &uip_aligned_buf;
+  }
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetpool_free(uip_buf_t *buf)
+{
+  if(buf == &uip_aligned_buf) {
+    aligned_buf_free = 1;
+  } else {
+    memb_free(&bufs_memb, buf);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_packetpool_numfree(void)
+{
+  return memb_numfree(&bufs_memb) + aligned_buf_free;
+}
+/*---------------------------------------------------------------------------*/
+uip_buf_t *
+uip_packetpool_detach(void)
+{
+  uip_buf_t *buf, *packet;
+
+  buf = uip_packetpool_alloc();
+  if(buf == NULL) {
+    return NULL;
+  }
+  packet = uip_bufp;
+  set_current(buf);
+  return packet;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetpool_attach(uip_buf_t *buf)
+{
+  uip_buf_t *old;
+
+  old = uip_bufp;
+  set_current(buf);
+  uip_packetpool_free(old);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_PACKET_POOL */
+
+/** @} */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         A pool of uIP packet buffers
+ *
+ *         When UIP_CONF_PACKET_POOL is set, uip_buf refers to one of
+ *         a pool of buffers instead of the single uip_aligned_buf.
+ *         The buffer of the current packet can be detached and
+ *         replaced by a free one, and a detached buffer can be made
+ *         current again later, without copying the packet.
+ */
+
+#ifndef UIP_PACKETPOOL_H_
+#define UIP_PACKETPOOL_H_
+
+#include "net/ip/uip.h"
+
+#if UIP_PACKET_POOL
+
+/**
+ * \brief      Allocate a buffer from the packet pool
+ * \return     A free buffer, or NULL if the pool is exhausted
+ */
+uip_buf_t *uip_packetpool_alloc(void);
+
+/**
+ * \brief      Return a buffer to the packet pool
+ * \param buf  A buffer that is not the current uip_buf
+ */
+void uip_packetpool_free(uip_buf_t *buf);
+
+/**
+ * \brief      The number of free buffers in the packet pool
+ */
+int uip_packetpool_numfree(void);
+
+/**
+ * \brief      Detach the current packet from uip_buf
+ * \return     The buffer holding the packet, or NULL if the pool has
+ *             no buffer to replace it with
+ *
+ *             uip_buf is switched to a free buffer. The packet keeps
+ *             its contents until the returned buffer is made current
+ *             again with uip_packetpool_attach() or freed. uip_len is
+ *             not changed and must be saved by the caller.
+ */
+uip_buf_t *uip_packetpool_detach(void);
+
+/**
+ * \brief      Make a detached packet the current one
+ * \param buf  A buffer returned by uip_packetpool_detach() or
+ *             uip_packetpool_alloc()
+ *
+ *             The buffer previously in uip_buf is freed. The caller
+ *             sets uip_len to the length of the packet.
+ */
+void uip_packetpool_attach(uip_buf_t *buf);
+
+#endif /* UIP_PACKET_POOL */
+
+#endif /* UIP_PACKETPOOL_H_ */
+
+/** @} */
@@ -5,6 +5,9 @@
 #include "lib/memb.h"
 
 #include "net/ip/uip-packetqueue.h"
+#include "net/ip/uip-packetpool.h"
+
+#include <string.h>
 
 #define MAX_NUM_QUEUED_PACKETS 2
 MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
@@ -24,10 +27,38 @@ packet_timedout(void *ptr)
   struct uip_packetqueue_handle *h = ptr;
 
   PRINTF("uip_packetqueue_free timed out %p\n", h);
+#if UIP_PACKET_POOL
+  uip_packetpool_free(h->packet->queue_buf);
+#endif /* UIP_PACKET_POOL */
   memb_free(&packets_memb, h->packet);
   h->packet = NULL;
 }
 /*---------------------------------------------------------------------------*/
+static struct uip_packetqueue_packet *
+alloc_entry(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
+{
+  if(handle->packet != NULL) {
+    PRINTF("alloced\n");
+    return NULL;
+  }
+  handle->packet = memb_alloc(&packets_memb);
+  if(handle->packet != NULL) {
+    ctimer_set(&handle->packet->lifetimer, lifetime,
+               packet_timedout, handle);
+  } else {
+    PRINTF("uip_packetqueue_alloc failed\n");
+  }
+  return handle->packet;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_entry(struct uip_packetqueue_handle *handle)
+{
+  ctimer_stop(&handle->packet->lifetimer);
+  memb_free(&packets_memb, handle->packet);
+  handle->packet = NULL;
+}
+/*---------------------------------------------------------------------------*/
 void
 uip_packetqueue_new(struct uip_packetqueue_handle *handle)
 {
@@ -39,17 +70,16 @@ struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
 {
   PRINTF("uip_packetqueue_alloc %p\n", handle);
-  if(handle->packet != NULL) {
-    PRINTF("alloced\n");
+  if(alloc_entry(handle, lifetime) == NULL) {
     return NULL;
   }
-  handle->packet = memb_alloc(&packets_memb);
-  if(handle->packet != NULL) {
-    ctimer_set(&handle->packet->lifetimer, lifetime,
-               packet_timedout, handle);
-  } else {
-    PRINTF("uip_packetqueue_alloc failed\n");
+#if UIP_PACKET_POOL
+  handle->packet->queue_buf = uip_packetpool_alloc();
+  if(handle->packet->queue_buf == NULL) {
+    PRINTF("uip_packetqueue_alloc: packet pool exhausted\n");
+    free_entry(handle);
   }
+#endif /* UIP_PACKET_POOL */
   return handle->packet;
 }
 /*---------------------------------------------------------------------------*/
@@ -58,16 +88,63 @@ uip_packetqueue_free(struct uip_packetqueue_handle *handle)
 {
   PRINTF("uip_packetqueue_free %p\n", handle);
   if(handle->packet != NULL) {
-    ctimer_stop(&handle->packet->lifetimer);
-    memb_free(&packets_memb, handle->packet);
-    handle->packet = NULL;
+#if UIP_PACKET_POOL
+    uip_packetpool_free(handle->packet->queue_buf);
+#endif /* UIP_PACKET_POOL */
+    free_entry(handle);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_packetqueue_save(struct uip_packetqueue_handle *h, clock_time_t lifetime)
+{
+#if UIP_PACKET_POOL
+  if(alloc_entry(h, lifetime) == NULL) {
+    return 0;
+  }
+  h->packet->queue_buf = uip_packetpool_detach();
+  if(h->packet->queue_buf == NULL) {
+    PRINTF("uip_packetqueue_save: packet pool exhausted\n");
+    free_entry(h);
+    return 0;
+  }
+#else /* UIP_PACKET_POOL */
+  if(uip_packetqueue_alloc(h, lifetime) == NULL) {
+    return 0;
+  }
+  memcpy(h->packet->queue_buf, &uip_buf[UIP_LLH_LEN], uip_len);
+#endif /* UIP_PACKET_POOL */
+  h->packet->queue_buf_len = uip_len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_packetqueue_restore(struct uip_packetqueue_handle *h)
+{
+  if(h->packet == NULL || h->packet->queue_buf_len == 0) {
+    return 0;
   }
+  uip_len = h->packet->queue_buf_len;
+#if UIP_PACKET_POOL
+  uip_packetpool_attach(h->packet->queue_buf);
+#else /* UIP_PACKET_POOL */
+  memcpy(&uip_buf[UIP_LLH_LEN], h->packet->queue_buf, uip_len);
+#endif /* UIP_PACKET_POOL */
+  free_entry(h);
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 uint8_t *
 uip_packetqueue_buf(struct uip_packetqueue_handle *h)
 {
-  return h->packet != NULL? h->packet->queue_buf: NULL;
+  if(h->packet == NULL) {
+    return NULL;
+  }
+#if UIP_PACKET_POOL
+  return &h->packet->queue_buf->u8[UIP_LLH_LEN];
+#else /* UIP_PACKET_POOL */
+  return h->packet->queue_buf;
+#endif /* UIP_PACKET_POOL */
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
@@ -2,12 +2,17 @@
 #define UIP_PACKETQUEUE_H
 
 #include "sys/ctimer.h"
+#include "net/ip/uip.h"
 
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
   struct uip_ds6_queued_packet *next;
+#if UIP_PACKET_POOL
+  uip_buf_t *queue_buf;
+#else /* UIP_PACKET_POOL */
   uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
+#endif /* UIP_PACKET_POOL */
   uint16_t queue_buf_len;
   struct ctimer lifetimer;
   struct uip_packetqueue_handle *handle;
@@ -31,5 +36,22 @@ uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
 uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
 void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
 
+/**
+ * Queue the packet in uip_buf on the handle. With a packet pool the
+ * packet stays in its buffer and uip_buf is switched to a free one;
+ * otherwise the packet is copied.
+ *
+ * \return Non-zero if the packet was queued.
+ */
+int uip_packetqueue_save(struct uip_packetqueue_handle *h, clock_time_t lifetime);
+
+/**
+ * Put the packet queued on the handle back into uip_buf, set uip_len
+ * and release the queue entry.
+ *
+ * \return Non-zero if a packet was queued.
+ */
+int uip_packetqueue_restore(struct uip_packetqueue_handle *h);
+
 
 #endif /* UIP_PACKETQUEUE_H */
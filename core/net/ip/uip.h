@@ -516,8 +516,16 @@ typedef union {
 
 CCIF extern uip_buf_t uip_aligned_buf;
 
+#if UIP_PACKET_POOL
+/** The packet pool buffer holding the current packet */
+CCIF extern uip_buf_t *uip_bufp;
+
+/** Macro to access the current packet buffer as an array of bytes */
+#define uip_buf (uip_bufp->u8)
+#else /* UIP_PACKET_POOL */
 /** Macro to access uip_aligned_buf as an array of bytes */
 #define uip_buf (uip_aligned_buf.u8)
+#endif /* UIP_PACKET_POOL */
 
 
 /** @} */
@@ -835,6 +843,51 @@ CCIF void uip_send(const void *data, int len);
  */
 #define uip_mss()             (uip_conn->mss)
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * Let a connection keep up to UIP_TCP_SEND_WINDOW bytes in flight.
+ *
+ * The application must then keep all data it has sent until it is
+ * acknowledged. On every callback it discards the first
+ * uip_ackedlen() bytes of that data if uip_acked() is true, and
+ * sends at most uip_sendlimit() bytes starting at uip_sendoffset()
+ * bytes into what remains. The offset points either at new data or,
+ * when uip_rexmit() is true, at data that must be retransmitted.
+ * After uip_close(), the FIN is sent once all data in flight is
+ * acknowledged, and until then only retransmissions are asked for.
+ *
+ * \param conn A pointer to the uip_conn structure for the connection.
+ *
+ * \hideinitializer
+ */
+#define uip_enable_window(conn) ((conn)->sndflags |= UIP_SND_WINDOW)
+
+/**
+ * The number of bytes acknowledged by the incoming segment.
+ *
+ * Only valid for connections set up with uip_enable_window() when
+ * uip_acked() is true.
+ *
+ * \hideinitializer
+ */
+#define uip_ackedlen()        (uip_acklen)
+
+/**
+ * Where the data to send in this callback starts, counted from the
+ * oldest unacknowledged byte.
+ *
+ * \hideinitializer
+ */
+#define uip_sendoffset()      (uip_sndoff)
+
+/**
+ * How many bytes may be sent in this callback.
+ *
+ * \hideinitializer
+ */
+#define uip_sendlimit()       (uip_sndlimit)
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /**
  * Set up a new UDP connection.
  *
@@ -871,7 +924,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+void uip_udp_remove(struct uip_udp_conn *conn);
+#else /* UIP_CONN_HASH */
 #define uip_udp_remove(conn) (conn)->lport = 0
+#endif /* UIP_CONN_HASH */
 
 /**
  * Bind a UDP connection to a local port.
@@ -883,7 +940,11 @@ struct uip_udp_conn *uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport);
  *
  * \hideinitializer
  */
+#if UIP_CONN_HASH
+void uip_udp_bind(struct uip_udp_conn *conn, uint16_t port);
+#else /* UIP_CONN_HASH */
 #define uip_udp_bind(conn, port) (conn)->lport = port
+#endif /* UIP_CONN_HASH */
 
 /**
  * Send a UDP datagram of length len on the current connection.
@@ -1320,6 +1381,13 @@ extern uint8_t uip_ext_len;
 extern uint16_t uip_urglen, uip_surglen;
 #endif /* UIP_URGDATA > 0 */
 
+#if UIP_TCP_SEND_WINDOW
+/* Send window state handed to applications that use
+   uip_enable_window(); read through the uip_ackedlen(),
+   uip_sendoffset() and uip_sendlimit() macros. */
+extern uint16_t uip_acklen, uip_sndoff, uip_sndlimit;
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /*
  * Clear uIP buffer
  *
@@ -1337,6 +1405,20 @@ extern uint16_t uip_urglen, uip_surglen;
 }
 #endif /*NETSTACK_CONF_WITH_IPV6*/
 
+#if UIP_TCP_SACK
+/** The number of SACK blocks a connection remembers. */
+#define UIP_TCP_SACK_BLOCKS 4
+
+/**
+ * A range of in-flight data that the peer has reported as received,
+ * as byte offsets from the connection's snd_nxt.
+ */
+struct uip_tcp_sack {
+  uint16_t start;
+  uint16_t end;
+};
+#endif /* UIP_TCP_SACK */
+
 /**
  * Representation of a uIP TCP connection.
  *
@@ -1370,6 +1452,26 @@ struct uip_conn {
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
+
+#if UIP_TCP_SEND_WINDOW
+  uint16_t wnd;          /**< The window last advertised by the peer. */
+  uint16_t rxt_nxt;      /**< Offset from snd_nxt of the next byte to
+                              retransmit during loss recovery. */
+  uint16_t recover;      /**< Offset from snd_nxt at which the current
+                              loss recovery ends. */
+  uint8_t sndflags;      /**< Send window flags (UIP_SND_*). */
+  uint8_t dupacks;       /**< The number of duplicate ACKs in a row. */
+#if UIP_TCP_SACK
+  uint8_t nsack;         /**< The number of valid entries in sack. */
+  struct uip_tcp_sack sack[UIP_TCP_SACK_BLOCKS]; /**< SACKed ranges,
+                                                      sorted. */
+#endif /* UIP_TCP_SACK */
+#endif /* UIP_TCP_SEND_WINDOW */
+
+#if UIP_CONN_HASH
+  struct uip_conn *hash_next; /**< Next connection in the same
+                                   demultiplexing bucket. */
+#endif /* UIP_CONN_HASH */
 };
 
 
@@ -1408,6 +1510,11 @@ struct uip_udp_conn {
 
   /** The application state. */
   uip_udp_appstate_t appstate;
+
+#if UIP_CONN_HASH
+  struct uip_udp_conn *hash_next; /**< Next connection bound to a
+                                       port in the same bucket. */
+#endif /* UIP_CONN_HASH */
 };
 
 /**
@@ -1507,6 +1614,15 @@ struct uip_stats {
     uip_stats_t recv;     /**< Number of recived ND6 packets */
     uip_stats_t sent;     /**< Number of sent ND6 packets */
   } nd6;
+  struct {
+    uip_stats_t recv;     /**< Number of received 6lowpan fragments. */
+    uip_stats_t drop;     /**< Number of 6lowpan fragments dropped because
+                               they matched no reassembly. */
+    uip_stats_t reassembled; /**< Number of packets reassembled. */
+    uip_stats_t timeout;  /**< Number of reassemblies that timed out. */
+    uip_stats_t evicted;  /**< Number of reassemblies discarded to make
+                               room for a new one. */
+  } frag;
 #endif /*NETSTACK_CONF_WITH_IPV6*/
 };
 
@@ -1615,6 +1731,14 @@ void uip_process(uint8_t flag);
 
 #define UIP_STOPPED      16
 
+#if UIP_TCP_SEND_WINDOW
+/* Flags for the sndflags field of struct uip_conn. */
+#define UIP_SND_WINDOW   1  /* The application uses the send window. */
+#define UIP_SND_RECOVERY 2  /* Retransmitting lost data. */
+#define UIP_SND_SACK_OK  4  /* The peer may send SACK blocks. */
+#define UIP_SND_CLOSE    8  /* Send a FIN once the data is acknowledged. */
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /* The TCP and IP headers. */
 struct uip_tcpip_hdr {
 #if NETSTACK_CONF_WITH_IPV6
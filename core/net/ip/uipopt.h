@@ -175,6 +175,24 @@
 #define UIP_BUFSIZE (UIP_CONF_BUFFER_SIZE)
 #endif /* UIP_CONF_BUFFER_SIZE */
 
+/**
+ * The number of buffers in the uIP packet pool, or 0 to process all
+ * packets in the single uip_aligned_buf.
+ *
+ * With a pool, uip_buf refers to the buffer of the packet being
+ * processed, and uip-packetpool.h can swap it for another one. Drivers
+ * can then read several packets ahead, and packets waiting for
+ * neighbor discovery are parked in their buffer instead of being
+ * copied. uip_aligned_buf is one of the buffers.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_PACKET_POOL
+#define UIP_PACKET_POOL (UIP_CONF_PACKET_POOL)
+#else /* UIP_CONF_PACKET_POOL */
+#define UIP_PACKET_POOL 0
+#endif /* UIP_CONF_PACKET_POOL */
+
 
 /**
  * Determines if statistics support should be compiled in.
@@ -435,6 +453,36 @@ void uip_log(char *msg);
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * Toggles whether incoming TCP segments and UDP datagrams are
+ * demultiplexed through a hash index over uip_conns and
+ * uip_udp_conns instead of a linear scan of both tables.
+ *
+ * The tables stay the storage; the index only chains their entries
+ * together. It is worth enabling when UIP_CONF_MAX_CONNECTIONS or
+ * UIP_CONF_UDP_CONNS are raised far above their defaults. It is
+ * ignored by the IPv4 stack.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_CONN_HASH) && NETSTACK_CONF_WITH_IPV6
+#define UIP_CONN_HASH (UIP_CONF_CONN_HASH)
+#else /* UIP_CONF_CONN_HASH */
+#define UIP_CONN_HASH 0
+#endif /* UIP_CONF_CONN_HASH */
+
+/**
+ * The number of buckets in each of the TCP and UDP demultiplexing
+ * hash tables.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH_SIZE
+#define UIP_CONN_HASH_SIZE (UIP_CONF_CONN_HASH_SIZE)
+#else /* UIP_CONF_CONN_HASH_SIZE */
+#define UIP_CONN_HASH_SIZE 32
+#endif /* UIP_CONF_CONN_HASH_SIZE */
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -500,6 +548,44 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of bytes a TCP connection may have in flight when its
+ * application has asked for windowed sending with
+ * uip_enable_window().
+ *
+ * Such an application keeps every byte it has sent until
+ * uip_ackedlen() reports it acknowledged, and places each new or
+ * retransmitted segment at uip_sendoffset(). Connections that do not
+ * opt in keep the one-segment-at-a-time behaviour. Setting this to 0
+ * compiles the send window out. It is ignored by the IPv4 stack.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_TCP_SEND_WINDOW) && NETSTACK_CONF_WITH_IPV6 && UIP_TCP
+#define UIP_TCP_SEND_WINDOW (UIP_CONF_TCP_SEND_WINDOW)
+#else /* UIP_CONF_TCP_SEND_WINDOW */
+#define UIP_TCP_SEND_WINDOW 0
+#endif /* UIP_CONF_TCP_SEND_WINDOW */
+
+/**
+ * Toggles selective acknowledgement (RFC 2018) for connections that
+ * use the send window.
+ *
+ * uIP then offers SACK in its SYN and SYNACK segments and uses the
+ * blocks the peer reports to retransmit only the holes in the data
+ * in flight. uIP itself drops out-of-order segments and so never
+ * sends SACK blocks. Enabled by default with the send window.
+ *
+ * \hideinitializer
+ */
+#if !UIP_TCP_SEND_WINDOW
+#define UIP_TCP_SACK 0
+#elif defined(UIP_CONF_TCP_SACK)
+#define UIP_TCP_SACK (UIP_CONF_TCP_SACK)
+#else /* UIP_CONF_TCP_SACK */
+#define UIP_TCP_SACK 1
+#endif /* UIP_CONF_TCP_SACK */
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -570,6 +656,17 @@ void uip_log(char *msg);
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of packets that can be reassembled at the same time at the
+ * 6lowpan layer, e.g. when several neighbors send fragmented packets
+ * concurrently. Each reassembly buffer uses UIP_BUFSIZE bytes of RAM.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -81,7 +81,7 @@ uint8_t p;
 #define PRINTFO(...) PRINTF(__VA_ARGS__)
 #define PRINTPACKETBUF() PRINTF("packetbuf buffer: "); for(p = 0; p < packetbuf_datalen(); p++){PRINTF("%.2X", *(packetbuf_ptr + p));} PRINTF("\n")
 #define PRINTUIPBUF() PRINTF("UIP buffer: "); for(p = 0; p < uip_len; p++){PRINTF("%.2X", uip_buf[p]);}PRINTF("\n")
-#define PRINTSICSLOWPANBUF() PRINTF("SICSLOWPAN buffer: "); for(p = 0; p < sicslowpan_len; p++){PRINTF("%.2X", sicslowpan_buf[p]);}PRINTF("\n")
+#define PRINTSICSLOWPANBUF() PRINTF("SICSLOWPAN buffer: "); for(p = 0; p < uip_len; p++){PRINTF("%.2X", sicslowpan_buf[p]);}PRINTF("\n")
 #else
 #define PRINTFI(...)
 #define PRINTFO(...)
@@ -174,6 +174,17 @@ void uip_log(char *msg);
 #define COMPRESSION_THRESHOLD 0
 #endif
 
+/** \brief With HC06, cache the encoding of the last addresses sent to
+    each neighbor known to ND, configurable through the
+    SICSLOWPAN_CONF_COMPRESSION_CACHE option. A hit trades the context
+    lookups and IID checks of both addresses for a neighbor table
+    lookup and two address comparisons. */
+#ifdef SICSLOWPAN_CONF_COMPRESSION_CACHE
+#define COMPRESSION_CACHE SICSLOWPAN_CONF_COMPRESSION_CACHE
+#else
+#define COMPRESSION_CACHE 0
+#endif
+
 /** \name General variables
  *  @{
  */
@@ -221,42 +232,59 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
-
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * A reassembly context. Fragments are matched to a context by the
+ * sender, the datagram tag and the datagram size (RFC 4944, 5.3), so
+ * datagrams from different senders can be reassembled concurrently.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+struct sicslowpan_reass {
+  /**
+   * The buffer used for the reassembly.
+   * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
+   * It has a fix size as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+  /** The total length of the IPv6 packet, 0 if the context is free. */
+  uint16_t len;
+  /**
+   * length of the ip packet already received.
+   * It includes IP and transport headers.
+   */
+  uint16_t processed;
+  /** The tag in the fragments being merged. */
+  uint16_t tag;
+  /** The source address of the fragments being merged */
+  linkaddr_t sender;
+  /** Reassembly %process %timer. */
+  struct timer timer;
+};
+
+static struct sicslowpan_reass reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+/**
+ * The context of the fragment being processed, NULL if the packet
+ * being processed is not a fragment.
+ */
+static struct sicslowpan_reass *reass;
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * The buffer the received packet is uncompressed into: the buffer of
+ * the reassembly context for fragments, uip_buf otherwise.
  */
-static uint16_t processed_ip_in_len;
+static uint8_t *sicslowpan_buf;
 
 /** Datagram tag to be put in the fragments I send. */
 static uint16_t my_tag;
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
-
-/** When reassembling, the source address of the fragments being merged */
-linkaddr_t frag_sender;
-
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+/** The packetbuf attributes of the datagram being fragmented. */
+static struct packetbuf_attr frag_attrs[PACKETBUF_NUM_ATTRS];
+static struct packetbuf_addr frag_addrs[PACKETBUF_NUM_ADDRS];
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
 /** The buffer used for the 6lowpan processing is uip_buf.
     We do not use any additional buffer.*/
 #define sicslowpan_buf uip_buf
-#define sicslowpan_len uip_len
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 static int last_rssi;
@@ -327,6 +355,28 @@ static struct sicslowpan_addr_context *context;
 /** pointer to the byte where to write next inline field. */
 static uint8_t *hc06_ptr;
 
+/* Encoding of a unicast address: the SAM or DAM mode, whether the
+   prefix comes from a context and the context number. The source
+   address can also be unspecified. */
+#define ADDR_ENC_MODE        0x03
+#define ADDR_ENC_CONTEXT     0x04
+#define ADDR_ENC_UNSPECIFIED 0x08
+#define ADDR_ENC_NUMBER(enc) ((enc) >> 4)
+
+#if COMPRESSION_CACHE
+/** The encodings of the last source and destination addresses sent
+    to a neighbor. The cache is keyed by the link-layer address the
+    addresses are compressed against. An unspecified address is never
+    cached, so a cleared entry never matches. */
+struct hc06_cache {
+  uip_ipaddr_t srcipaddr;
+  uip_ipaddr_t destipaddr;
+  uint8_t src_enc;
+  uint8_t dest_enc;
+};
+NBR_TABLE(struct hc06_cache, hc06_caches);
+#endif /* COMPRESSION_CACHE */
+
 /* Uncompression of linklocal */
 /*   0 -> 16 bytes from packet  */
 /*   1 -> 2 bytes from prefix - bunch of zeroes and 8 from packet */
@@ -394,22 +444,61 @@ addr_context_lookup_by_number(uint8_t number)
   return NULL;
 }
 /*--------------------------------------------------------------------*/
+/** \brief the address mode for the IID of ipaddr */
 static uint8_t
-compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
+addr_mode_64(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
 {
   if(uip_is_addr_mac_addr_based(ipaddr, lladdr)) {
-    return 3 << bitpos; /* 0-bits */
+    return 3; /* 0-bits */
   } else if(sicslowpan_is_iid_16_bit_compressable(ipaddr)) {
     /* compress IID to 16 bits xxxx::0000:00ff:fe00:XXXX */
-    memcpy(hc06_ptr, &ipaddr->u16[7], 2);
-    hc06_ptr += 2;
-    return 2 << bitpos; /* 16-bits */
+    return 2; /* 16-bits */
   } else {
     /* do not compress IID => xxxx::IID */
+    return 1; /* 64-bits */
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief encode a unicast address, compressed against lladdr */
+static uint8_t
+addr_encoding(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
+{
+  struct sicslowpan_addr_context *c;
+
+  if((c = addr_context_lookup_by_prefix(ipaddr)) != NULL) {
+    /* elide the prefix */
+    return (c->number << 4) | ADDR_ENC_CONTEXT | addr_mode_64(ipaddr, lladdr);
+  } else if(uip_is_addr_linklocal(ipaddr) &&
+            ipaddr->u16[1] == 0 &&
+            ipaddr->u16[2] == 0 &&
+            ipaddr->u16[3] == 0) {
+    return addr_mode_64(ipaddr, lladdr);
+  }
+  /* send the full address */
+  return 0; /* 128-bits */
+}
+/*--------------------------------------------------------------------*/
+/** \brief inline the bits of ipaddr that its encoding does not elide */
+static uint8_t
+compress_addr(uint8_t bitpos, uint8_t enc, uip_ipaddr_t *ipaddr)
+{
+  switch(enc & ADDR_ENC_MODE) {
+  case 3:
+    break;
+  case 2:
+    memcpy(hc06_ptr, &ipaddr->u16[7], 2);
+    hc06_ptr += 2;
+    break;
+  case 1:
     memcpy(hc06_ptr, &ipaddr->u16[4], 8);
     hc06_ptr += 8;
-    return 1 << bitpos; /* 64-bits */
+    break;
+  default:
+    memcpy(hc06_ptr, &ipaddr->u16[0], 16);
+    hc06_ptr += 16;
+    break;
   }
+  return (enc & ADDR_ENC_MODE) << bitpos;
 }
 
 /*-------------------------------------------------------------------- */
@@ -492,7 +581,10 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
 static void
 compress_hdr_hc06(linkaddr_t *link_destaddr)
 {
-  uint8_t tmp, iphc0, iphc1;
+  uint8_t tmp, iphc0, iphc1, src_enc, dest_enc;
+#if COMPRESSION_CACHE
+  struct hc06_cache *cache;
+#endif /* COMPRESSION_CACHE */
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -523,11 +615,60 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
    */
 
 
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
+#if COMPRESSION_CACHE
+  cache = nbr_table_get_from_lladdr(hc06_caches, link_destaddr);
+  if(cache == NULL &&
+     nbr_table_get_from_lladdr(ds6_neighbors, link_destaddr) != NULL) {
+    /* Only neighbors known to ND get an entry, as adding any other
+       would make the neighbor table evict one of them. */
+    cache = nbr_table_add_lladdr(hc06_caches, link_destaddr);
+  }
+#endif /* COMPRESSION_CACHE */
+
+  /* source address - cannot be multicast */
+  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+    src_enc = ADDR_ENC_UNSPECIFIED;
+  } else {
+#if COMPRESSION_CACHE
+    if(cache != NULL &&
+       uip_ipaddr_cmp(&cache->srcipaddr, &UIP_IP_BUF->srcipaddr)) {
+      src_enc = cache->src_enc;
+    } else {
+      src_enc = addr_encoding(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+      if(cache != NULL) {
+        uip_ipaddr_copy(&cache->srcipaddr, &UIP_IP_BUF->srcipaddr);
+        cache->src_enc = src_enc;
+      }
+    }
+#else /* COMPRESSION_CACHE */
+    src_enc = addr_encoding(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+#endif /* COMPRESSION_CACHE */
+  }
+
+  /* dest address - compressed against the link address */
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    dest_enc = 0;
+  } else {
+#if COMPRESSION_CACHE
+    if(cache != NULL &&
+       uip_ipaddr_cmp(&cache->destipaddr, &UIP_IP_BUF->destipaddr)) {
+      dest_enc = cache->dest_enc;
+    } else {
+      dest_enc = addr_encoding(&UIP_IP_BUF->destipaddr,
+                               (uip_lladdr_t *)link_destaddr);
+      if(cache != NULL) {
+        uip_ipaddr_copy(&cache->destipaddr, &UIP_IP_BUF->destipaddr);
+        cache->dest_enc = dest_enc;
+      }
+    }
+#else /* COMPRESSION_CACHE */
+    dest_enc = addr_encoding(&UIP_IP_BUF->destipaddr,
+                             (uip_lladdr_t *)link_destaddr);
+#endif /* COMPRESSION_CACHE */
+  }
+
+  /* check if a context is used (for allocating third byte) */
+  if((src_enc | dest_enc) & ADDR_ENC_CONTEXT) {
     /* set context flag and increase hc06_ptr */
     PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
@@ -619,33 +760,21 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
   }
 
   /* source address - cannot be multicast */
-  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+  if(src_enc & ADDR_ENC_UNSPECIFIED) {
     PRINTF("IPHC: compressing unspecified - setting SAC\n");
     iphc1 |= SICSLOWPAN_IPHC_SAC;
     iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
-    /* elide the prefix - indicate by CID and set context + SAC */
-    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
-           context->number);
-    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
-    PACKETBUF_IPHC_BUF[2] |= context->number << 4;
-    /* compession compare with this nodes address (source) */
-
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
-    /* No context found for this address */
-  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
-            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[3] == 0) {
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
   } else {
-    /* send the full address => SAC = 0, SAM = 00 */
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
-    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
-    hc06_ptr += 16;
+    if(src_enc & ADDR_ENC_CONTEXT) {
+      /* elide the prefix - indicate by CID and set context + SAC */
+      PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
+             ADDR_ENC_NUMBER(src_enc));
+      iphc1 |= SICSLOWPAN_IPHC_SAC;
+      PACKETBUF_IPHC_BUF[2] |= ADDR_ENC_NUMBER(src_enc) << 4;
+    }
+    /* compession compare with this nodes address (source) */
+    iphc1 |= compress_addr(SICSLOWPAN_IPHC_SAM_BIT, src_enc,
+                           &UIP_IP_BUF->srcipaddr);
   }
 
   /* dest address*/
@@ -677,28 +806,14 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
     }
   } else {
     /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
+    if(dest_enc & ADDR_ENC_CONTEXT) {
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
-      PACKETBUF_IPHC_BUF[2] |= context->number;
-      /* compession compare with link adress (destination) */
-
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-                                &UIP_IP_BUF->destipaddr,
-                                (uip_lladdr_t *)link_destaddr);
-      /* No context found for this address */
-    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
-              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[3] == 0) {
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-               &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
-    } else {
-      /* send the full address */
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
-      hc06_ptr += 16;
+      PACKETBUF_IPHC_BUF[2] |= ADDR_ENC_NUMBER(dest_enc);
     }
+    /* compession compare with link adress (destination) */
+    iphc1 |= compress_addr(SICSLOWPAN_IPHC_DAM_BIT, dest_enc,
+                           &UIP_IP_BUF->destipaddr);
   }
 
   uncomp_hdr_len = UIP_IPH_LEN;
@@ -1449,7 +1564,7 @@ output(const uip_lladdr_t *localdest)
 
   if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
-    struct queuebuf *q;
+    uint16_t frag_tag;
     /*
      * The outbound IPv6 packet is too large to fit into a single 15.4
      * packet, so we fragment it into multiple packets and send them.
@@ -1458,7 +1573,7 @@ output(const uip_lladdr_t *localdest)
      * The following fragments contain only the fragn dispatch.
      */
     int estimated_fragments = ((int)uip_len) / (max_payload - SICSLOWPAN_FRAGN_HDR_LEN) + 1;
-    int freebuf = queuebuf_numfree() - 1;
+    int freebuf = queuebuf_numfree();
     PRINTFO("uip_len: %d, fragments: %d, free bufs: %d\n", uip_len, estimated_fragments, freebuf);
     if(freebuf < estimated_fragments) {
       PRINTFO("Dropping packet, not enough free bufs\n");
@@ -1482,8 +1597,8 @@ output(const uip_lladdr_t *localdest)
     SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
           ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
 /*     PACKETBUF_FRAG_BUF->tag = uip_htons(my_tag); */
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, my_tag);
-    my_tag++;
+    frag_tag = my_tag++;
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
 
     /* Copy payload and send */
     packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
@@ -1492,15 +1607,10 @@ output(const uip_lladdr_t *localdest)
     memcpy(packetbuf_ptr + packetbuf_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, packetbuf_payload_len);
     packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-    q = queuebuf_new_from_packetbuf();
-    if(q == NULL) {
-      PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
-      return 0;
-    }
+    /* The layers below may change the attributes, so keep them for
+       the following fragments. */
+    packetbuf_attr_copyto(frag_attrs, frag_addrs);
     send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
-    q = NULL;
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1515,17 +1625,22 @@ output(const uip_lladdr_t *localdest)
 
     /*
      * Create following fragments
-     * Datagram tag is already in the buffer, we need to set the
-     * FRAGN dispatch and for each fragment, the offset
+     * The MAC layer has queued its own copy of the previous fragment
+     * and the layers below may have framed or encrypted packetbuf in
+     * place, so each fragment is rebuilt from a cleared packetbuf: the
+     * FRAGN dispatch, the datagram tag and the offset
      */
     packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-/*     PACKETBUF_FRAG_BUF->dispatch_size = */
-/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
     packetbuf_payload_len = (max_payload - packetbuf_hdr_len) & 0xfffffff8;
     while(processed_ip_out_len < uip_len) {
       PRINTFO("sicslowpan output: fragment ");
+      packetbuf_clear();
+      packetbuf_attr_copyfrom(frag_attrs, frag_addrs);
+/*     PACKETBUF_FRAG_BUF->dispatch_size = */
+/*       uip_htons((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len); */
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
       PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
 
       /* Copy payload and send */
@@ -1538,15 +1653,7 @@ output(const uip_lladdr_t *localdest)
       memcpy(packetbuf_ptr + packetbuf_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, packetbuf_payload_len);
       packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
-      q = queuebuf_new_from_packetbuf();
-      if(q == NULL) {
-        PRINTFO("could not allocate queuebuf, dropping fragment\n");
-        return 0;
-      }
       send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
-      q = NULL;
       processed_ip_out_len += packetbuf_payload_len;
 
       /* Check tx result. */
@@ -1575,6 +1682,76 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that have timed out */
+static void
+reass_expire(void)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = reass_contexts; r < reass_contexts + SICSLOWPAN_REASS_CONTEXTS; r++) {
+    if(r->len > 0 && timer_expired(&r->timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n", r->tag);
+      UIP_STAT(++uip_stat.frag.timeout);
+      r->len = 0;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Find the reassembly context of the fragment in packetbuf */
+static struct sicslowpan_reass *
+reass_lookup(uint16_t tag, uint16_t size)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = reass_contexts; r < reass_contexts + SICSLOWPAN_REASS_CONTEXTS; r++) {
+    if(r->len == size && r->tag == tag &&
+       linkaddr_cmp(&r->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Start reassembling the datagram of the first fragment in packetbuf
+ *
+ * If all contexts are in use, the oldest reassembly is discarded: a
+ * datagram that has not completed by then is the most likely to have
+ * lost a fragment.
+ */
+static struct sicslowpan_reass *
+reass_new(uint16_t tag, uint16_t size)
+{
+  struct sicslowpan_reass *r, *oldest;
+
+  oldest = NULL;
+  for(r = reass_contexts; r < reass_contexts + SICSLOWPAN_REASS_CONTEXTS; r++) {
+    if(r->len == 0) {
+      break;
+    }
+    if(oldest == NULL ||
+       timer_remaining(&r->timer) < timer_remaining(&oldest->timer)) {
+      oldest = r;
+    }
+  }
+  if(r == reass_contexts + SICSLOWPAN_REASS_CONTEXTS) {
+    PRINTFI("sicslowpan input: discarding reassembly (tag %d)\n", oldest->tag);
+    UIP_STAT(++uip_stat.frag.evicted);
+    r = oldest;
+  }
+
+  r->len = size;
+  r->processed = 0;
+  r->tag = tag;
+  linkaddr_copy(&r->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  timer_set(&r->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          r->len, r->tag);
+  return r;
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1582,8 +1759,9 @@ output(const uip_lladdr_t *localdest)
  *  The 6lowpan packet is put in packetbuf by the MAC. If its a frag1 or
  *  a non-fragmented packet we first uncompress the IP header. The
  *  6lowpan payload and possibly the uncompressed IP header are then
- *  copied in siclowpan_buf. If the IP packet is complete it is copied
- *  to uip_buf and the IP layer is called.
+ *  copied in uip_buf, or in the buffer of the reassembly context of the
+ *  fragment. If the IP packet is complete it is copied to uip_buf and
+ *  the IP layer is called.
  *
  * \note We do not check for overlapping sicslowpan fragments
  * (it is a SHALL in the RFC 4944 and should never happen)
@@ -1613,11 +1791,8 @@ input(void)
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  /* cancel the reassemblies that timed out */
+  reass_expire();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1633,7 +1808,6 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
-      /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
       first_fragment = 1;
       is_fragment = 1;
       break;
@@ -1649,77 +1823,56 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-
-  if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+  reass = NULL;
+  sicslowpan_buf = uip_buf;
+  if(is_fragment) {
+    UIP_STAT(++uip_stat.frag.recv);
+    if(frag_size == 0) {
+      /* A free context has length 0, so it must not be looked up */
+      PRINTFI("sicslowpan input: Dropping 6lowpan fragment of empty packet\n");
+      UIP_STAT(++uip_stat.frag.drop);
       return;
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
+    reass = reass_lookup(frag_tag, frag_size);
+    if(first_fragment) {
+      /*
+       * Start a new reassembly, or restart the current one if the
+       * first fragment is received again.
+       */
+      if(frag_size > UIP_BUFSIZE) {
+        PRINTFI("sicslowpan input: Dropping 6lowpan fragment of too large packet (len %d)\n",
+                frag_size);
+        UIP_STAT(++uip_stat.frag.drop);
         return;
       }
-
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      linkaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      if(reass == NULL) {
+        reass = reass_new(frag_tag, frag_size);
+      }
+      reass->processed = 0;
+    } else if(reass == NULL) {
+      /*
+       * the packet is a fragment that does not belong to any of the
+       * packets being reassembled.
+       */
+      PRINTFI("sicslowpan input: Dropping 6lowpan fragment that does not belong to a packet being reassembled\n");
+      UIP_STAT(++uip_stat.frag.drop);
+      return;
+    } else {
+      /* If this is the last fragment, we may shave off any extrenous
+         bytes at the end. We must be liberal in what we accept. */
+      PRINTFI("last_fragment?: processed %d packetbuf_payload_len %d frag_size %d\n",
+              reass->processed, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
+      if(reass->processed + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
+        last_fragment = 1;
+      }
     }
+    sicslowpan_buf = reass->buf.u8;
   }
 
   if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1781,77 +1934,72 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          packetbuf_payload_len, req_size, sizeof(sicslowpan_buf));
+          packetbuf_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
 
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
 
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
+  /* update the reassembly context if fragment, uip_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
+  if(reass != NULL) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
+      reass->processed += uncomp_hdr_len;
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
     if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
+      reass->processed = frag_size;
     } else {
-      processed_ip_in_len += packetbuf_payload_len;
+      reass->processed += packetbuf_payload_len;
+    }
+    PRINTF("processed %d, packetbuf_payload_len %d, len %d\n",
+           reass->processed, packetbuf_payload_len, reass->len);
+    if(reass->processed < reass->len) {
+      return;
     }
-    PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", processed_ip_in_len, packetbuf_payload_len);
 
-  } else {
+    /*
+     * We have a full IP packet in the reassembly buffer, deliver it
+     * to the IP stack
+     */
+    PRINTFI("sicslowpan input: IP packet ready (length %d)\n", reass->len);
+    UIP_STAT(++uip_stat.frag.reassembled);
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, reass->len);
+    uip_len = reass->len;
+    reass->len = 0;
+  } else
 #endif /* SICSLOWPAN_CONF_FRAG */
-    sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
+  {
+    uip_len = packetbuf_payload_len + uncomp_hdr_len;
   }
 
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-#endif /* SICSLOWPAN_CONF_FRAG */
-
 #if DEBUG
-    {
-      uint16_t ndx;
-      PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
-      for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
-        uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
-        PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint16_t ndx;
+    PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
+    for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
-    /* if callback is set then set attributes and call */
-    if(callback) {
-      set_packet_attrs();
-      callback->input_callback();
-    }
-
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+  /* if callback is set then set attributes and call */
+  if(callback) {
+    set_packet_attrs();
+    callback->input_callback();
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+
+  tcpip_input();
 }
 /** @} */
 
@@ -1868,6 +2016,10 @@ sicslowpan_init(void)
   tcpip_set_outputfunc(output);
 
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+#if COMPRESSION_CACHE
+  nbr_table_register(hc06_caches, NULL);
+#endif /* COMPRESSION_CACHE */
+
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
  * The platform contiki-conf.h file can override this using e.g.
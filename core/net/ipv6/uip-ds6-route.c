@@ -72,12 +72,85 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_HASH
+/* Host routes are chained in hash buckets, all other routes are kept
+   on the prefix list. Lookups do not reorder the route list in this
+   mode; the lookup counter is used to find the least recently used
+   route instead. */
+static uip_ds6_route_t *host_routes[UIP_DS6_ROUTE_HASH_SIZE];
+static uip_ds6_route_t *prefix_routes;
+static uint32_t lookups;
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+static uip_ds6_route_t **
+host_chain(const uip_ipaddr_t *addr)
+{
+  unsigned int h;
+  int i;
+
+  /* Routes in a network mostly differ in the interface identifier */
+  h = 0;
+  for(i = 8; i < 16; i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  return &host_routes[h % UIP_DS6_ROUTE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t **
+hash_chain(uip_ds6_route_t *r)
+{
+  return r->length == 128 ? host_chain(&r->ipaddr) : &prefix_routes;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **chain;
+
+  chain = hash_chain(r);
+  r->hash_next = *chain;
+  *chain = r;
+  r->last_lookup = lookups;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = hash_chain(r); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == r) {
+      *p = r->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+least_recently_used(void)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *oldest;
+
+  oldest = NULL;
+  for(r = list_head(routelist); r != NULL; r = list_item_next(r)) {
+    if(oldest == NULL ||
+       (uint32_t)(lookups - r->last_lookup) >
+       (uint32_t)(lookups - oldest->last_lookup)) {
+      oldest = r;
+    }
+  }
+  return oldest;
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 #if DEBUG != DEBUG_NONE
 static void
 assert_nbr_routes_list_sane(void)
@@ -148,6 +221,10 @@ uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(host_routes, 0, sizeof(host_routes));
+  prefix_routes = NULL;
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -216,9 +293,23 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 
   found_route = NULL;
   longestmatch = 0;
+#if UIP_DS6_ROUTE_HASH
+  lookups++;
+  /* A host route is always the longest match */
+  for(r = *host_chain(addr); r != NULL; r = r->hash_next) {
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      found_route = r;
+      break;
+    }
+  }
+  for(r = found_route == NULL ? prefix_routes : NULL;
+      r != NULL;
+      r = r->hash_next) {
+#else /* UIP_DS6_ROUTE_HASH */
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
+#endif /* UIP_DS6_ROUTE_HASH */
     if(r->length >= longestmatch &&
        uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
       longestmatch = r->length;
@@ -240,6 +331,11 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if UIP_DS6_ROUTE_HASH
+  if(found_route != NULL) {
+    found_route->last_lookup = lookups;
+  }
+#else /* UIP_DS6_ROUTE_HASH */
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -249,6 +345,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   return found_route;
 }
@@ -301,7 +398,11 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
          least recently used route is the first route on the list. */
       uip_ds6_route_t *oldest;
 
+#if UIP_DS6_ROUTE_HASH
+      oldest = least_recently_used();
+#else /* UIP_DS6_ROUTE_HASH */
       oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+#endif /* UIP_DS6_ROUTE_HASH */
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -374,6 +475,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  hash_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -412,6 +516,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH
+    hash_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -88,6 +88,22 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Keep /128 host routes in a hash table and other routes on a separate
+   prefix list, so that route lookups do not scan the whole routing
+   table. Useful for a RPL storing mode root with many routes. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_DS6_ROUTE_HASH UIP_CONF_DS6_ROUTE_HASH
+#else /* UIP_CONF_DS6_ROUTE_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_HASH */
+
+/* Number of hash buckets for host routes */
+#ifdef UIP_CONF_DS6_ROUTE_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_CONF_DS6_ROUTE_HASH_SIZE
+#else /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE (UIP_DS6_ROUTE_NB / 2 + 1)
+#endif /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -121,6 +137,12 @@ typedef struct uip_ds6_route {
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
   uint8_t length;
+#if UIP_DS6_ROUTE_HASH
+  /* Next route in the same hash bucket, or on the prefix list */
+  struct uip_ds6_route *hash_next;
+  /* Value of the lookup counter when the route was last used */
+  uint32_t last_lookup;
+#endif /* UIP_DS6_ROUTE_HASH */
 } uip_ds6_route_t;
 
 /** \brief A neighbor route list entry, used on the
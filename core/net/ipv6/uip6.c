@@ -209,8 +209,12 @@ struct uip_conn *uip_conn;
 
 /* Temporary variables. */
 #if (UIP_TCP || UIP_UDP)
+#if UIP_CONNS > 255 || UIP_UDP_CONNS > 255 || UIP_LISTENPORTS > 255
+static uint16_t c;
+#else
 static uint8_t c;
 #endif
+#endif
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
 /* Keeps track of the last port used for a new connection. */
@@ -238,7 +242,11 @@ static uint16_t lastport;
 #define TCP_OPT_NOOP    1   /* "No-operation" TCP option */
 #define TCP_OPT_MSS     2   /* Maximum segment size TCP option */
 
+#define TCP_OPT_SACK_PERM 4 /* SACK permitted TCP option */
+#define TCP_OPT_SACK    5   /* SACK TCP option */
+
 #define TCP_OPT_MSS_LEN 4   /* Length of TCP MSS option. */
+#define TCP_OPT_SACK_PERM_LEN 2 /* Length of TCP SACK permitted option. */
 /** @} */
 /**
  * \name TCP variables
@@ -273,6 +281,57 @@ struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
 #endif /* UIP_UDP */
 /** @} */
 
+/*---------------------------------------------------------------------------*/
+/**
+ * \name Connection demultiplexing index
+ * @{
+ */
+/*---------------------------------------------------------------------------*/
+#if UIP_CONN_HASH
+/*
+ * TCP connections are hashed on (lport, rport, ripaddr) and UDP
+ * connections on lport alone, since a UDP connection may leave rport
+ * and ripaddr as wildcards. Each chain is kept in table order so that
+ * the first match in a chain is the one the linear scan would find.
+ *
+ * UDP entries are linked while lport is non-zero. TCP entries are
+ * linked from the moment a slot is given a connection and stay linked
+ * after it closes; lookups skip CLOSED entries, and the slot is moved
+ * to its new chain when it is reused.
+ */
+#if UIP_TCP
+static struct uip_conn *tcp_hash[UIP_CONN_HASH_SIZE];
+#endif /* UIP_TCP */
+#if UIP_UDP
+static struct uip_udp_conn *udp_hash[UIP_CONN_HASH_SIZE];
+#endif /* UIP_UDP */
+#endif /* UIP_CONN_HASH */
+
+#if UIP_TCP_SEND_WINDOW
+uint16_t uip_acklen, uip_sndoff, uip_sndlimit;
+
+/* Offset from snd_nxt of the segment being sent, for windowed
+   connections. */
+static uint16_t tcp_seq_off;
+/* Set when the next hole must be retransmitted even if no SACK block
+   shows data beyond it: on entering recovery and on partial ACKs. */
+static uint8_t tcp_rxt_force;
+
+#if UIP_TCP_SEND_WINDOW > 32767
+/* Resending a window's worth of presumed lost data may put up to
+   twice the window in flight. */
+#error UIP_CONF_TCP_SEND_WINDOW must not exceed 32767 bytes
+#endif
+
+/* The number of duplicate ACKs that trigger a fast retransmit. */
+#define TCP_DUPACK_THRESHOLD 3
+
+static void tcp_window_prepare(void);
+#else /* UIP_TCP_SEND_WINDOW */
+#define tcp_window_prepare()
+#endif /* UIP_TCP_SEND_WINDOW */
+/** @} */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \name ICMPv6 variables
@@ -429,6 +488,396 @@ uip_udpchksum(void)
 #endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+#if UIP_CONN_HASH
+#if UIP_TCP
+static struct uip_conn **
+tcp_chain(uint16_t lport, uint16_t rport, const uip_ipaddr_t *ripaddr)
+{
+  uint16_t h;
+
+  h = lport ^ rport ^ ripaddr->u16[5] ^ ripaddr->u16[6] ^ ripaddr->u16[7];
+  return &tcp_hash[uip_ntohs(h) % UIP_CONN_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_hash_remove(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+
+  for(p = tcp_chain(conn->lport, conn->rport, &conn->ripaddr);
+      *p != NULL; p = &(*p)->hash_next) {
+    if(*p == conn) {
+      *p = conn->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_hash_add(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+
+  for(p = tcp_chain(conn->lport, conn->rport, &conn->ripaddr);
+      *p != NULL && *p < conn; p = &(*p)->hash_next);
+  conn->hash_next = *p;
+  *p = conn;
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP
+static struct uip_udp_conn **
+udp_chain(uint16_t lport)
+{
+  return &udp_hash[uip_ntohs(lport) % UIP_CONN_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_remove(struct uip_udp_conn *conn)
+{
+  struct uip_udp_conn **p;
+
+  if(conn->lport == 0) {
+    return;
+  }
+  for(p = udp_chain(conn->lport); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == conn) {
+      *p = conn->hash_next;
+      break;
+    }
+  }
+  conn->lport = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_udp_bind(struct uip_udp_conn *conn, uint16_t port)
+{
+  struct uip_udp_conn **p;
+
+  uip_udp_remove(conn);
+  conn->lport = port;
+  if(port == 0) {
+    return;
+  }
+  for(p = udp_chain(port); *p != NULL && *p < conn; p = &(*p)->hash_next);
+  conn->hash_next = *p;
+  *p = conn;
+}
+#endif /* UIP_UDP */
+#endif /* UIP_CONN_HASH */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+static void
+tcp_rtt_update(struct uip_conn *conn)
+{
+  signed char m;
+  m = conn->rto - conn->timer;
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+/*
+ * A windowed connection keeps snd_nxt at the oldest unacknowledged
+ * byte and len at the number of bytes in flight, as the one-segment
+ * scheme does. Everything else (the retransmission point, the end of
+ * loss recovery and the SACK scoreboard) is kept as byte offsets from
+ * snd_nxt, so a cumulative ACK shifts them all down by the same
+ * amount.
+ */
+static uint32_t
+tcp_seq(const uint8_t *seq)
+{
+  return ((uint32_t)seq[0] << 24) | ((uint32_t)seq[1] << 16) |
+    ((uint32_t)seq[2] << 8) | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+tcp_shift(uint16_t off, uint16_t acked)
+{
+  return off > acked ? off - acked : 0;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_SACK
+static void
+tcp_sack_add(struct uip_conn *conn, uint16_t start, uint16_t end)
+{
+  struct uip_tcp_sack *b = conn->sack;
+  uint8_t i, j, n = conn->nsack;
+
+  for(i = 0; i < n && b[i].end < start; i++);
+
+  if(i < n && b[i].start <= end) {
+    /* Overlapping or adjacent: widen the block and absorb any later
+       blocks it now reaches. */
+    if(start < b[i].start) {
+      b[i].start = start;
+    }
+    if(end > b[i].end) {
+      b[i].end = end;
+    }
+    for(j = i + 1; j < n && b[j].start <= b[i].end; j++) {
+      if(b[j].end > b[i].end) {
+        b[i].end = b[j].end;
+      }
+    }
+    memmove(&b[i + 1], &b[j], (n - j) * sizeof(*b));
+    conn->nsack = n - (j - i - 1);
+    return;
+  }
+
+  /* A new block. When the scoreboard is full the highest block is
+     forgotten; the data it covers is simply retransmitted. */
+  if(n == UIP_TCP_SACK_BLOCKS) {
+    if(i == n) {
+      return;
+    }
+    n--;
+  }
+  memmove(&b[i + 1], &b[i], (n - i) * sizeof(*b));
+  b[i].start = start;
+  b[i].end = end;
+  conn->nsack = n + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_sack_input(struct uip_conn *conn)
+{
+  uint8_t *opts = &uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN];
+  uint8_t optlen = ((UIP_TCP_BUF->tcpoffset >> 4) - 5) << 2;
+  uint32_t una = tcp_seq(conn->snd_nxt);
+  uint32_t start, end;
+  uint8_t i, j;
+
+  for(i = 0; i < optlen;) {
+    if(opts[i] == TCP_OPT_END) {
+      break;
+    } else if(opts[i] == TCP_OPT_NOOP) {
+      ++i;
+      continue;
+    }
+    if(i + 1 >= optlen || opts[i + 1] < 2 || i + opts[i + 1] > optlen) {
+      /* Malformed options. */
+      break;
+    }
+    if(opts[i] == TCP_OPT_SACK) {
+      for(j = i + 2; j + 8 <= i + opts[i + 1]; j += 8) {
+        start = tcp_seq(&opts[j]) - una;
+        end = tcp_seq(&opts[j + 4]) - una;
+        /* Ignore blocks that are not within the data in flight, such
+           as D-SACK reports of data already acknowledged. */
+        if(start < end && end <= conn->len) {
+          tcp_sack_add(conn, start, end);
+        }
+      }
+    }
+    i += opts[i + 1];
+  }
+}
+#endif /* UIP_TCP_SACK */
+/*---------------------------------------------------------------------------*/
+static void
+tcp_window_ack(void)
+{
+  struct uip_conn *conn = uip_conn;
+  uint32_t acked;
+  uint16_t wnd;
+#if UIP_TCP_SACK
+  uint8_t i, j;
+#endif /* UIP_TCP_SACK */
+
+  acked = tcp_seq(UIP_TCP_BUF->ackno) - tcp_seq(conn->snd_nxt);
+  wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+
+  if(acked > 0 && acked <= conn->len) {
+    uip_add32(conn->snd_nxt, acked);
+    conn->snd_nxt[0] = uip_acc32[0];
+    conn->snd_nxt[1] = uip_acc32[1];
+    conn->snd_nxt[2] = uip_acc32[2];
+    conn->snd_nxt[3] = uip_acc32[3];
+    conn->len -= acked;
+    uip_acklen = acked;
+
+    conn->rxt_nxt = tcp_shift(conn->rxt_nxt, acked);
+#if UIP_TCP_SACK
+    for(i = j = 0; i < conn->nsack; i++) {
+      if(conn->sack[i].end > acked) {
+        conn->sack[j].start = tcp_shift(conn->sack[i].start, acked);
+        conn->sack[j].end = conn->sack[i].end - acked;
+        j++;
+      }
+    }
+    conn->nsack = j;
+#endif /* UIP_TCP_SACK */
+    if(conn->sndflags & UIP_SND_RECOVERY) {
+      conn->recover = tcp_shift(conn->recover, acked);
+      if(conn->recover == 0) {
+        conn->sndflags &= ~UIP_SND_RECOVERY;
+      } else {
+        /* A partial ACK: the next hole is lost as well. */
+        tcp_rxt_force = 1;
+        uip_flags = UIP_REXMIT;
+      }
+    } else if(conn->nrtx == 0) {
+      tcp_rtt_update(conn);
+    }
+
+    uip_flags |= UIP_ACKDATA;
+    conn->nrtx = 0;
+    conn->dupacks = 0;
+    conn->timer = conn->rto;
+  }
+
+#if UIP_TCP_SACK
+  if((conn->sndflags & UIP_SND_SACK_OK) &&
+     (UIP_TCP_BUF->tcpoffset & 0xf0) > 0x50) {
+    tcp_sack_input(conn);
+  }
+#endif /* UIP_TCP_SACK */
+
+  if(acked == 0 && uip_len == 0 && wnd == conn->wnd &&
+     (UIP_TCP_BUF->flags & (TCP_SYN | TCP_FIN)) == 0) {
+    if(conn->dupacks < 255) {
+      ++conn->dupacks;
+    }
+    if(!(conn->sndflags & UIP_SND_RECOVERY)) {
+      if(conn->dupacks == TCP_DUPACK_THRESHOLD) {
+        /* Fast retransmit: everything up to what is in flight now is
+           suspect, starting with the oldest byte. */
+        conn->sndflags |= UIP_SND_RECOVERY;
+        conn->recover = conn->len;
+        conn->rxt_nxt = 0;
+        tcp_rxt_force = 1;
+        uip_flags = UIP_REXMIT;
+      }
+    } else {
+      /* Each further duplicate ACK means a segment has left the
+         network, making room to resend another. */
+      uip_flags = UIP_REXMIT;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_window_rto(void)
+{
+  struct uip_conn *conn = uip_conn;
+
+  /* Everything in flight is presumed lost. The peer may have
+     discarded what it reported through SACK, so the scoreboard is
+     cleared and the data is resent from the oldest byte onwards. */
+  conn->sndflags |= UIP_SND_RECOVERY;
+  conn->recover = conn->len;
+  conn->rxt_nxt = 0;
+  conn->dupacks = 0;
+#if UIP_TCP_SACK
+  conn->nsack = 0;
+#endif /* UIP_TCP_SACK */
+  tcp_rxt_force = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_window_prepare(void)
+{
+  struct uip_conn *conn = uip_conn;
+  uint16_t off, end, cap, inflight;
+#if UIP_TCP_SACK
+  uint16_t lost;
+  uint8_t i;
+#endif /* UIP_TCP_SACK */
+
+  uip_sndoff = conn->len;
+  uip_sndlimit = 0;
+
+  /* A zero window still lets one segment through as a window
+     probe. */
+  cap = conn->wnd == 0 ? conn->initialmss : MIN(conn->wnd, UIP_TCP_SEND_WINDOW);
+
+  inflight = conn->len;
+  if(conn->sndflags & UIP_SND_RECOVERY) {
+    /* Work out how much data is still in the network. Without SACK
+       information, everything from rxt_nxt up to recover is presumed
+       lost and is resent a window at a time. With it, SACKed data has
+       left the network, and so have the holes below the highest SACK
+       block that have not been resent yet. */
+#if UIP_TCP_SACK
+    if(conn->nsack > 0) {
+      end = MIN(conn->sack[conn->nsack - 1].start, conn->recover);
+      lost = end > conn->rxt_nxt ? end - conn->rxt_nxt : 0;
+      for(i = 0; i < conn->nsack; i++) {
+        inflight -= conn->sack[i].end - conn->sack[i].start;
+        off = MAX(conn->sack[i].start, conn->rxt_nxt);
+        if(MIN(conn->sack[i].end, end) > off) {
+          lost -= MIN(conn->sack[i].end, end) - off;
+        }
+      }
+      inflight -= lost;
+    } else
+#endif /* UIP_TCP_SACK */
+    {
+      inflight -= conn->recover - conn->rxt_nxt;
+    }
+    if(inflight >= cap) {
+      tcp_rxt_force = 0;
+      uip_flags &= ~UIP_REXMIT;
+      return;
+    }
+
+    /* Find the first byte from rxt_nxt onwards that the peer has not
+       reported through SACK, and where that hole ends. Once the peer
+       reports SACK blocks, only holes with data beyond them are
+       treated as lost, unless this is the first retransmission of a
+       recovery or follows a partial ACK. */
+    off = conn->rxt_nxt;
+    end = conn->recover;
+#if UIP_TCP_SACK
+    for(i = 0; i < conn->nsack; i++) {
+      if(conn->sack[i].end <= off) {
+        continue;
+      }
+      if(conn->sack[i].start <= off) {
+        off = conn->sack[i].end;
+        continue;
+      }
+      if(conn->sack[i].start < end) {
+        end = conn->sack[i].start;
+      }
+      tcp_rxt_force = 1;
+      break;
+    }
+    if(conn->nsack == 0) {
+      tcp_rxt_force = 1;
+    }
+#else /* UIP_TCP_SACK */
+    tcp_rxt_force = 1;
+#endif /* UIP_TCP_SACK */
+    if(off < end && tcp_rxt_force) {
+      tcp_rxt_force = 0;
+      uip_flags |= UIP_REXMIT;
+      uip_sndoff = off;
+      uip_sndlimit = MIN(MIN(end - off, cap - inflight), conn->initialmss);
+      return;
+    }
+    uip_flags &= ~UIP_REXMIT;
+  }
+  tcp_rxt_force = 0;
+
+  /* New data, as far as the peer's window and ours allow, unless
+     the application has closed the connection. */
+  if(inflight < cap && !(conn->sndflags & UIP_SND_CLOSE)) {
+    uip_sndlimit = MIN(cap - inflight, conn->initialmss);
+  }
+}
+#endif /* UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
 void
 uip_init(void)
 {
@@ -444,6 +893,9 @@ uip_init(void)
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
   }
+#if UIP_CONN_HASH
+  memset(tcp_hash, 0, sizeof(tcp_hash));
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -454,6 +906,9 @@ uip_init(void)
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
   }
+#if UIP_CONN_HASH
+  memset(udp_hash, 0, sizeof(udp_hash));
+#endif /* UIP_CONN_HASH */
 #endif /* UIP_UDP */
 
 #if UIP_CONF_IPV6_MULTICAST
@@ -524,9 +979,23 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_SEND_WINDOW
+  conn->wnd = 0;
+  conn->sndflags = 0;
+  conn->dupacks = 0;
+#if UIP_TCP_SACK
+  conn->nsack = 0;
+#endif /* UIP_TCP_SACK */
+#endif /* UIP_TCP_SEND_WINDOW */
+#if UIP_CONN_HASH
+  tcp_hash_remove(conn);
+#endif /* UIP_CONN_HASH */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_CONN_HASH
+  tcp_hash_add(conn);
+#endif /* UIP_CONN_HASH */
 
   return conn;
 }
@@ -570,11 +1039,20 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     lastport = 4096;
   }
 
+#if UIP_CONN_HASH
+  for(conn = *udp_chain(uip_htons(lastport)); conn != NULL;
+      conn = conn->hash_next) {
+    if(conn->lport == uip_htons(lastport)) {
+      goto again;
+    }
+  }
+#else /* UIP_CONN_HASH */
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     if(uip_udp_conns[c].lport == uip_htons(lastport)) {
       goto again;
     }
   }
+#endif /* UIP_CONN_HASH */
 
   conn = 0;
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
@@ -588,7 +1066,7 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     return 0;
   }
 
-  conn->lport = UIP_HTONS(lastport);
+  uip_udp_bind(conn, UIP_HTONS(lastport));
   conn->rport = rport;
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
@@ -955,8 +1433,15 @@ uip_process(uint8_t flag)
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+#if UIP_TCP_SEND_WINDOW
+       /* A windowed connection may send while data is in flight. */
+       ((uip_connr->sndflags & UIP_SND_WINDOW) ||
+        !uip_outstanding(uip_connr))) {
+#else /* UIP_TCP_SEND_WINDOW */
        !uip_outstanding(uip_connr)) {
+#endif /* UIP_TCP_SEND_WINDOW */
       uip_flags = UIP_POLL;
+      tcp_window_prepare();
       UIP_APPCALL();
       goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -1051,6 +1536,20 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
             case UIP_ESTABLISHED:
+#if UIP_TCP_SEND_WINDOW
+              if(uip_connr->sndflags & UIP_SND_WINDOW) {
+                /*
+                 * A windowed connection resends from the oldest
+                 * unacknowledged byte, one segment now and the rest
+                 * as the ACKs come in.
+                 */
+                tcp_window_rto();
+                uip_flags = UIP_REXMIT;
+                tcp_window_prepare();
+                UIP_APPCALL();
+                goto appsend;
+              }
+#endif /* UIP_TCP_SEND_WINDOW */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1074,6 +1573,7 @@ uip_process(uint8_t flag)
          * application for new data.
          */
         uip_flags = UIP_POLL;
+        tcp_window_prepare();
         UIP_APPCALL();
         goto appsend;
       }
@@ -1506,9 +2006,15 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONN_HASH
+  for(uip_udp_conn = *udp_chain(UIP_UDP_BUF->destport);
+      uip_udp_conn != NULL;
+      uip_udp_conn = uip_udp_conn->hash_next) {
+#else /* UIP_CONN_HASH */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
+#endif /* UIP_CONN_HASH */
     /* If the local UDP port is non-zero, the connection is considered
        to be used. If so, the local port number is checked against the
        destination port number in the received packet. If the two port
@@ -1615,8 +2121,14 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONN_HASH
+  for(uip_connr = *tcp_chain(UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport,
+                             &UIP_IP_BUF->srcipaddr);
+      uip_connr != NULL; uip_connr = uip_connr->hash_next) {
+#else /* UIP_CONN_HASH */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
+#endif /* UIP_CONN_HASH */
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
        UIP_TCP_BUF->destport == uip_connr->lport &&
        UIP_TCP_BUF->srcport == uip_connr->rport &&
@@ -1736,9 +2248,23 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_SEND_WINDOW
+  uip_connr->wnd = 0;
+  uip_connr->sndflags = 0;
+  uip_connr->dupacks = 0;
+#if UIP_TCP_SACK
+  uip_connr->nsack = 0;
+#endif /* UIP_TCP_SACK */
+#endif /* UIP_TCP_SEND_WINDOW */
+#if UIP_CONN_HASH
+  tcp_hash_remove(uip_connr);
+#endif /* UIP_CONN_HASH */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
+#if UIP_CONN_HASH
+  tcp_hash_add(uip_connr);
+#endif /* UIP_CONN_HASH */
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
 
   uip_connr->snd_nxt[0] = iss[0];
@@ -1772,8 +2298,17 @@ uip_process(uint8_t flag)
         uip_connr->initialmss = uip_connr->mss =
           tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
 
+#if UIP_TCP_SACK
+        /* Keep looking for the SACK permitted option. */
+        c += TCP_OPT_MSS_LEN;
+      } else if(opt == TCP_OPT_SACK_PERM &&
+                uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == TCP_OPT_SACK_PERM_LEN) {
+        uip_connr->sndflags |= UIP_SND_SACK_OK;
+        c += TCP_OPT_SACK_PERM_LEN;
+#else /* UIP_TCP_SACK */
         /* And we are done processing options. */
         break;
+#endif /* UIP_TCP_SACK */
       } else {
         /* All other options have a length field, so that we easily
            can skip past them. */
@@ -1806,7 +2341,21 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->optdata[2] = (UIP_TCP_MSS) / 256;
   UIP_TCP_BUF->optdata[3] = (UIP_TCP_MSS) & 255;
   uip_len = UIP_IPTCPH_LEN + TCP_OPT_MSS_LEN;
+#if UIP_TCP_SACK
+  /* Offer SACK in a SYN, and accept it in a SYNACK if the SYN offered
+     it. */
+  if(!(UIP_TCP_BUF->flags & TCP_ACK) ||
+     (uip_connr->sndflags & UIP_SND_SACK_OK)) {
+    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + TCP_OPT_MSS_LEN] = TCP_OPT_NOOP;
+    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + TCP_OPT_MSS_LEN + 1] = TCP_OPT_NOOP;
+    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + TCP_OPT_MSS_LEN + 2] = TCP_OPT_SACK_PERM;
+    uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + TCP_OPT_MSS_LEN + 3] = TCP_OPT_SACK_PERM_LEN;
+    uip_len += 4;
+  }
+  UIP_TCP_BUF->tcpoffset = ((uip_len - UIP_IPH_LEN) / 4) << 4;
+#else /* UIP_TCP_SACK */
   UIP_TCP_BUF->tcpoffset = ((UIP_TCPH_LEN + TCP_OPT_MSS_LEN) / 4) << 4;
+#endif /* UIP_TCP_SACK */
   goto tcp_send;
 
   /* This label will be jumped to if we found an active connection. */
@@ -1864,6 +2413,15 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW
+    /* A windowed connection accepts ACKs for part of the data in
+       flight, and counts duplicate ACKs. */
+    if((uip_connr->sndflags & UIP_SND_WINDOW) &&
+       (uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      tcp_window_ack();
+      goto acked;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
     if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
@@ -1878,18 +2436,7 @@ uip_process(uint8_t flag)
 
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        tcp_rtt_update(uip_connr);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1901,6 +2448,11 @@ uip_process(uint8_t flag)
     }
 
   }
+#if UIP_TCP_SEND_WINDOW
+ acked:
+  uip_connr->wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+    (uint16_t)UIP_TCP_BUF->wnd[1];
+#endif /* UIP_TCP_SEND_WINDOW */
 
   /* Do different things depending on in what state the connection is. */
   switch(uip_connr->tcpstateflags & UIP_TS_MASK) {
@@ -1922,6 +2474,7 @@ uip_process(uint8_t flag)
           uip_add_rcv_nxt(uip_len);
         }
         uip_slen = 0;
+        tcp_window_prepare();
         UIP_APPCALL();
         goto appsend;
       }
@@ -1957,8 +2510,17 @@ uip_process(uint8_t flag)
               uip_connr->initialmss =
                 uip_connr->mss = tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
 
+#if UIP_TCP_SACK
+              /* Keep looking for the SACK permitted option. */
+              c += TCP_OPT_MSS_LEN;
+            } else if(opt == TCP_OPT_SACK_PERM &&
+                      uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == TCP_OPT_SACK_PERM_LEN) {
+              uip_connr->sndflags |= UIP_SND_SACK_OK;
+              c += TCP_OPT_SACK_PERM_LEN;
+#else /* UIP_TCP_SACK */
               /* And we are done processing options. */
               break;
+#endif /* UIP_TCP_SACK */
             } else {
               /* All other options have a length field, so that we easily
                  can skip past them. */
@@ -1981,6 +2543,7 @@ uip_process(uint8_t flag)
         uip_connr->len = 0;
         uip_clear_buf();
         uip_slen = 0;
+        tcp_window_prepare();
         UIP_APPCALL();
         goto appsend;
       }
@@ -2088,8 +2651,9 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
-      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT)) {
         uip_slen = 0;
+        tcp_window_prepare();
         UIP_APPCALL();
 
       appsend:
@@ -2101,6 +2665,25 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_SEND_WINDOW
+        if((uip_connr->sndflags & UIP_SND_CLOSE) && uip_connr->len == 0) {
+          /* Everything sent before uip_close() is acknowledged. */
+          uip_flags = UIP_CLOSE;
+        } else if((uip_flags & UIP_CLOSE) &&
+                  (uip_connr->sndflags & UIP_SND_WINDOW) &&
+                  uip_connr->len > 0) {
+          /* The FIN goes after the data in flight, so it waits until
+             all of that data is acknowledged. uip_close() hides
+             whether the segment carried new data, so it is
+             acknowledged in any case. */
+          if(!(uip_connr->sndflags & UIP_SND_CLOSE)) {
+            uip_connr->sndflags |= UIP_SND_CLOSE;
+            uip_slen = 0;
+          }
+          uip_flags = UIP_NEWDATA;
+        }
+#endif /* UIP_TCP_SEND_WINDOW */
+
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
           uip_connr->len = 1;
@@ -2111,6 +2694,28 @@ uip_process(uint8_t flag)
         }
 
         /* If uip_slen > 0, the application has data to be sent. */
+#if UIP_TCP_SEND_WINDOW
+        if(uip_slen > 0 && (uip_connr->sndflags & UIP_SND_WINDOW)) {
+          /* The application sent what it was asked for, at
+             uip_sendoffset(), clipped to uip_sendlimit(). New data
+             extends the data in flight; anything else is a
+             retransmission. */
+          if(uip_slen > uip_sndlimit) {
+            uip_slen = uip_sndlimit;
+          }
+          if(uip_sndoff == uip_connr->len) {
+            uip_connr->len += uip_slen;
+          } else {
+            uip_connr->rxt_nxt = uip_sndoff + uip_slen;
+          }
+          if(uip_slen > 0) {
+            uip_len = uip_slen + UIP_TCPIP_HLEN;
+            tcp_seq_off = uip_sndoff;
+            UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+            goto tcp_send_noopts;
+          }
+        } else
+#endif /* UIP_TCP_SEND_WINDOW */
         if(uip_slen > 0) {
 
           /* If the connection has acknowledged data, the contents of
@@ -2142,6 +2747,11 @@ uip_process(uint8_t flag)
             uip_slen = uip_connr->len;
           }
         }
+#if UIP_TCP_SEND_WINDOW
+        /* A windowed connection counts retransmissions until new data
+           is acknowledged. */
+        if(!(uip_connr->sndflags & UIP_SND_WINDOW))
+#endif /* UIP_TCP_SEND_WINDOW */
         uip_connr->nrtx = 0;
       apprexmit:
         uip_appdata = uip_sappdata;
@@ -2161,6 +2771,11 @@ uip_process(uint8_t flag)
         if(uip_flags & UIP_NEWDATA) {
           uip_len = UIP_TCPIP_HLEN;
           UIP_TCP_BUF->flags = TCP_ACK;
+#if UIP_TCP_SEND_WINDOW
+          if(uip_connr->sndflags & UIP_SND_WINDOW) {
+            tcp_seq_off = uip_connr->len;
+          }
+#endif /* UIP_TCP_SEND_WINDOW */
           goto tcp_send_noopts;
         }
       }
@@ -2255,10 +2870,22 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
 
-  UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
-  UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
-  UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
-  UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SEND_WINDOW
+  if(tcp_seq_off > 0) {
+    uip_add32(uip_connr->snd_nxt, tcp_seq_off);
+    UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+    UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+    UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+    UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+    tcp_seq_off = 0;
+  } else
+#endif /* UIP_TCP_SEND_WINDOW */
+  {
+    UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
+    UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
+    UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
+    UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+  }
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
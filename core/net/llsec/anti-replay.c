@@ -49,6 +49,10 @@
 /* This node's current frame counter value */
 static uint32_t counter;
 
+#if ANTI_REPLAY_WINDOW
+struct anti_replay_stats anti_replay_stats;
+#endif /* ANTI_REPLAY_WINDOW */
+
 /*---------------------------------------------------------------------------*/
 void
 anti_replay_set_counter(void)
@@ -79,7 +83,41 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW
+  /* Nothing tells which of the older frames were received already */
+  info->broadcast_window = info->unicast_window = ~(anti_replay_window_t)0;
+#endif /* ANTI_REPLAY_WINDOW */
+}
+/*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW
+static int
+was_replayed(uint32_t *last_counter, anti_replay_window_t *window,
+    uint32_t received_counter)
+{
+  uint32_t age;
+
+  if(received_counter > *last_counter) {
+    /* slide the window */
+    age = received_counter - *last_counter;
+    *window = age < ANTI_REPLAY_WINDOW ? (*window << age) | 1 : 1;
+    *last_counter = received_counter;
+    return 0;
+  }
+
+  age = *last_counter - received_counter;
+  if(age >= ANTI_REPLAY_WINDOW) {
+    anti_replay_stats.too_old++;
+    return 1;
+  }
+  if(*window & ((anti_replay_window_t)1 << age)) {
+    anti_replay_stats.replayed++;
+    return 1;
+  }
+  *window |= (anti_replay_window_t)1 << age;
+  anti_replay_stats.reordered++;
+  return 0;
 }
+#endif /* ANTI_REPLAY_WINDOW */
 /*---------------------------------------------------------------------------*/
 int
 anti_replay_was_replayed(struct anti_replay_info *info)
@@ -88,6 +126,15 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   received_counter = anti_replay_get_counter();
   
+#if ANTI_REPLAY_WINDOW
+  if(packetbuf_holds_broadcast()) {
+    return was_replayed(&info->last_broadcast_counter,
+        &info->broadcast_window, received_counter);
+  } else {
+    return was_replayed(&info->last_unicast_counter,
+        &info->unicast_window, received_counter);
+  }
+#else /* ANTI_REPLAY_WINDOW */
   if(packetbuf_holds_broadcast()) {
     /* broadcast */
     if(received_counter <= info->last_broadcast_counter) {
@@ -105,6 +152,7 @@ anti_replay_was_replayed(struct anti_replay_info *info)
       return 0;
     }
   }
+#endif /* ANTI_REPLAY_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
 
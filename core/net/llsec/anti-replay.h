@@ -47,11 +47,49 @@
 
 #include "contiki.h"
 
+/**
+ * Number of frame counters below the last one received from a
+ * neighbor that are still accepted, once each, when their frames
+ * arrive out of order. With 0, any frame older than the last one is
+ * taken for a replay.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW
+#define ANTI_REPLAY_WINDOW ANTI_REPLAY_CONF_WINDOW
+#else /* ANTI_REPLAY_CONF_WINDOW */
+#define ANTI_REPLAY_WINDOW 0
+#endif /* ANTI_REPLAY_CONF_WINDOW */
+
+#if ANTI_REPLAY_WINDOW > 64
+#error "ANTI_REPLAY_CONF_WINDOW must not exceed 64 frames"
+#elif ANTI_REPLAY_WINDOW > 32
+typedef uint64_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW > 0
+typedef uint32_t anti_replay_window_t;
+#endif
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW
+  /* Bit i is set once the frame with the last counter minus i is received */
+  anti_replay_window_t broadcast_window;
+  anti_replay_window_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW */
 };
 
+#if ANTI_REPLAY_WINDOW
+struct anti_replay_stats {
+  /* Frames accepted with a counter below the last one */
+  unsigned long reordered;
+  /* Frames rejected as their counter was in the window and seen before */
+  unsigned long replayed;
+  /* Frames rejected as their counter was below the window */
+  unsigned long too_old;
+};
+
+extern struct anti_replay_stats anti_replay_stats;
+#endif /* ANTI_REPLAY_WINDOW */
+
 /**
  * \brief Sets the frame counter packetbuf attributes.
  */
@@ -858,7 +858,11 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       }
       
       packetbuf_set_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED, 1);
-      queuebuf_update_from_packetbuf(curr->buf);
+      if(!queuebuf_update_from_packetbuf(curr->buf)) {
+        PRINTF("contikimac: no room for the created frame\n");
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+        return;
+      }
     }
     curr = next;
   } while(next != NULL);
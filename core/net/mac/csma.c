@@ -98,6 +98,11 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+#if CSMA_FAIR
+  /* Set while the neighbor waits for its turn to send */
+  uint8_t ready;
+  struct neighbor_queue *ready_next;
+#endif /* CSMA_FAIR */
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -115,15 +120,182 @@ struct neighbor_queue {
 #define CSMA_MAX_PACKET_PER_NEIGHBOR MAX_QUEUED_PACKETS
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
+/* The number of hash buckets for the neighbor queues in CSMA_FAIR mode */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE 8
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
+#if CSMA_FAIR
+/* The neighbor queues are chained in hash buckets through their next
+   field. The neighbors waiting for their turn to send are on the
+   ready list, in order. */
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+static struct neighbor_queue *ready_head, *ready_tail;
+static struct ctimer schedule_timer;
+/* Packets pushed out of their queue are reported from a timer, after
+   the send_packet() call that pushed them out has returned. */
+struct pushed_report {
+  mac_callback_t sent;
+  void *cptr;
+  linkaddr_t addr;
+};
+static struct pushed_report pushed_reports[MAX_QUEUED_PACKETS];
+static uint8_t pushed_count;
+static struct ctimer pushed_timer;
+struct csma_stats csma_stats;
+#else /* CSMA_FAIR */
 LIST(neighbor_list);
+#endif /* CSMA_FAIR */
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
 
+#if CSMA_FAIR
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue **
+neighbor_chain(const linkaddr_t *addr)
+{
+  unsigned int h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  return &neighbor_hash[h % CSMA_NEIGHBOR_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_from_addr(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  for(n = *neighbor_chain(addr); n != NULL; n = n->next) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_add(struct neighbor_queue *n)
+{
+  struct neighbor_queue **chain;
+
+  chain = neighbor_chain(&n->addr);
+  n->next = *chain;
+  *chain = n;
+  n->ready = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_remove(struct neighbor_queue *n)
+{
+  struct neighbor_queue **p;
+
+  for(p = neighbor_chain(&n->addr); *p != NULL; p = &(*p)->next) {
+    if(*p == n) {
+      *p = n->next;
+      break;
+    }
+  }
+  if(n->ready) {
+    for(p = &ready_head; *p != n; p = &(*p)->ready_next);
+    *p = n->ready_next;
+    if(ready_tail == n) {
+      ready_tail = NULL;
+      for(n = ready_head; n != NULL; n = n->ready_next) {
+        ready_tail = n;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send one packet of the neighbor whose turn it is */
+static void
+schedule(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q;
+
+  n = ready_head;
+  if(n == NULL) {
+    return;
+  }
+  ready_head = n->ready_next;
+  if(ready_head == NULL) {
+    ready_tail = NULL;
+  } else {
+    ctimer_set(&schedule_timer, 0, schedule, NULL);
+  }
+  n->ready = 0;
+
+  q = list_head(n->queued_packet_list);
+  if(q != NULL) {
+    PRINTF("csma: sending to the next ready neighbor, queue len %d\n",
+           list_length(n->queued_packet_list));
+    queuebuf_to_packetbuf(q->buf);
+    NETSTACK_RDC.send(packet_sent, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Report the packets that were pushed out of their queue. The sent
+   callbacks find the receiver in packetbuf, so it is set for each of
+   them and restored afterwards. */
+static void
+report_pushed(void *ptr)
+{
+  linkaddr_t receiver;
+  uint8_t i;
+
+  linkaddr_copy(&receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  for(i = 0; i < pushed_count; i++) {
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &pushed_reports[i].addr);
+    mac_call_sent_callback(pushed_reports[i].sent, pushed_reports[i].cptr,
+                           MAC_TX_ERR, 1);
+  }
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+  pushed_count = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The longest queue, if it is longer than the one of the neighbor n
+   will be with one more packet */
+static struct neighbor_queue *
+longest_queue(struct neighbor_queue *n)
+{
+  struct neighbor_queue *m, *longest;
+  int i, len, longest_len;
+
+  longest = NULL;
+  longest_len = list_length(n->queued_packet_list) + 1;
+  for(i = 0; i < CSMA_NEIGHBOR_HASH_SIZE; i++) {
+    for(m = neighbor_hash[i]; m != NULL; m = m->next) {
+      len = list_length(m->queued_packet_list);
+      if(m != n && len > longest_len) {
+        longest = m;
+        longest_len = len;
+      }
+    }
+  }
+  return longest;
+}
+/*---------------------------------------------------------------------------*/
+int
+csma_queue_length(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  n = neighbor_queue_from_addr(addr);
+  return n == NULL ? 0 : list_length(n->queued_packet_list);
+}
+#else /* CSMA_FAIR */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
@@ -138,6 +310,19 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static void
+neighbor_add(struct neighbor_queue *n)
+{
+  list_add(neighbor_list, n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_remove(struct neighbor_queue *n)
+{
+  list_remove(neighbor_list, n);
+}
+#endif /* CSMA_FAIR */
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -164,8 +349,25 @@ transmit_packet_list(void *ptr)
     if(q != NULL) {
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+#if CSMA_FAIR
+      /* Wait for the turn of the neighbor */
+      if(!n->ready) {
+        n->ready = 1;
+        n->ready_next = NULL;
+        if(ready_tail == NULL) {
+          ready_head = n;
+        } else {
+          ready_tail->ready_next = n;
+        }
+        ready_tail = n;
+      }
+      if(ctimer_expired(&schedule_timer)) {
+        ctimer_set(&schedule_timer, 0, schedule, NULL);
+      }
+#else /* CSMA_FAIR */
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
+#endif /* CSMA_FAIR */
     }
   }
 }
@@ -195,7 +397,7 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
+      neighbor_remove(n);
       memb_free(&neighbor_memb, n);
     }
   }
@@ -316,10 +518,53 @@ packet_sent(void *ptr, int status, int num_transmissions)
 }
 /*---------------------------------------------------------------------------*/
 static void
+queue_packet(struct neighbor_queue *n, struct rdc_buf_list *q,
+             mac_callback_t sent, void *ptr)
+{
+  struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
+
+  if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
+    /* Use default configuration for max transmissions */
+    metadata->max_transmissions = CSMA_MAX_MAC_TRANSMISSIONS;
+  } else {
+    metadata->max_transmissions =
+      packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
+  }
+  metadata->sent = sent;
+  metadata->cptr = ptr;
+#if PACKETBUF_WITH_PACKET_TYPE
+  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
+     PACKETBUF_ATTR_PACKET_TYPE_ACK) {
+    list_push(n->queued_packet_list, q);
+  } else
+#endif
+  {
+    list_add(n->queued_packet_list, q);
+  }
+
+  PRINTF("csma: send_packet, queue length %d, free packets %d\n",
+         list_length(n->queued_packet_list), memb_numfree(&packet_memb));
+#if CSMA_FAIR
+  csma_stats.queued++;
+  if(list_length(n->queued_packet_list) > csma_stats.max_queue_len) {
+    csma_stats.max_queue_len = list_length(n->queued_packet_list);
+  }
+#endif /* CSMA_FAIR */
+  /* If q is the first packet in the neighbor's queue, send asap */
+  if(list_head(n->queued_packet_list) == q) {
+    ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   struct rdc_buf_list *q;
   struct neighbor_queue *n;
+#if CSMA_FAIR
+  struct neighbor_queue *m;
+  struct pushed_report *pushed;
+#endif /* CSMA_FAIR */
   static uint8_t initialized = 0;
   static uint16_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -351,7 +596,7 @@ send_packet(mac_callback_t sent, void *ptr)
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      neighbor_add(n);
     }
   }
 
@@ -364,33 +609,8 @@ send_packet(mac_callback_t sent, void *ptr)
         if(q->ptr != NULL) {
           q->buf = queuebuf_new_from_packetbuf();
           if(q->buf != NULL) {
-            struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
             /* Neighbor and packet successfully allocated */
-            if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
-              /* Use default configuration for max transmissions */
-              metadata->max_transmissions = CSMA_MAX_MAC_TRANSMISSIONS;
-            } else {
-              metadata->max_transmissions =
-                packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
-            }
-            metadata->sent = sent;
-            metadata->cptr = ptr;
-#if PACKETBUF_WITH_PACKET_TYPE
-            if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
-               PACKETBUF_ATTR_PACKET_TYPE_ACK) {
-              list_push(n->queued_packet_list, q);
-            } else
-#endif
-            {
-              list_add(n->queued_packet_list, q);
-            }
-
-            PRINTF("csma: send_packet, queue length %d, free packets %d\n",
-                   list_length(n->queued_packet_list), memb_numfree(&packet_memb));
-            /* If q is the first packet in the neighbor's queue, send asap */
-            if(list_head(n->queued_packet_list) == q) {
-              ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
-            }
+            queue_packet(n, q, sent, ptr);
             return;
           }
           memb_free(&metadata_memb, q->ptr);
@@ -399,17 +619,56 @@ send_packet(mac_callback_t sent, void *ptr)
         memb_free(&packet_memb, q);
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
       }
+#if CSMA_FAIR
+      m = pushed_count < MAX_QUEUED_PACKETS ? longest_queue(n) : NULL;
+      if(m != NULL) {
+        /* Reuse the buffers of the last packet of the longest queue.
+           That packet is not the first of its queue, so it is not
+           being sent. */
+        q = list_chop(m->queued_packet_list);
+        pushed = &pushed_reports[pushed_count];
+        pushed->sent = ((struct qbuf_metadata *)q->ptr)->sent;
+        pushed->cptr = ((struct qbuf_metadata *)q->ptr)->cptr;
+        if(queuebuf_update_from_packetbuf(q->buf)) {
+          pushed_count++;
+          linkaddr_copy(&pushed->addr, &m->addr);
+          queue_packet(n, q, sent, ptr);
+          PRINTF("csma: pushed out a packet from a queue of %d\n",
+                 list_length(m->queued_packet_list) + 1);
+          csma_stats.pushed_out++;
+          /* The caller may still be using packetbuf and its own sent
+             status, so the dropped packet is reported later */
+          if(ctimer_expired(&pushed_timer)) {
+            ctimer_set(&pushed_timer, 0, report_pushed, NULL);
+          }
+          return;
+        }
+        /* The new frame does not fit in that buffer, so the packet
+           stays in its queue and the new one is dropped */
+        PRINTF("csma: could not reuse a queuebuf, dropping packet\n");
+        list_add(m->queued_packet_list, q);
+      }
+#endif /* CSMA_FAIR */
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
+        neighbor_remove(n);
         memb_free(&neighbor_memb, n);
       }
+#if CSMA_FAIR
+      csma_stats.dropped_nobuf++;
+#endif /* CSMA_FAIR */
     } else {
       PRINTF("csma: Neighbor queue full\n");
+#if CSMA_FAIR
+      csma_stats.dropped_full++;
+#endif /* CSMA_FAIR */
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
+#if CSMA_FAIR
+    csma_stats.dropped_nobuf++;
+#endif /* CSMA_FAIR */
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
@@ -447,6 +706,12 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+#if CSMA_FAIR
+  memset(neighbor_hash, 0, sizeof(neighbor_hash));
+  ready_head = ready_tail = NULL;
+  pushed_count = 0;
+  memset(&csma_stats, 0, sizeof(csma_stats));
+#endif /* CSMA_FAIR */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
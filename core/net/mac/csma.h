@@ -42,8 +42,40 @@
 #define CSMA_H_
 
 #include "net/mac/mac.h"
+#include "net/linkaddr.h"
 #include "dev/radio.h"
 
+/* CSMA_FAIR shares the packet queues fairly between neighbors. The
+   neighbor queues are found through a hash table, the neighbors with
+   a packet to send take turns one packet at a time, and when the
+   buffers run out a packet for a short queue takes the place of the
+   last packet of the longest one. */
+#ifdef CSMA_CONF_FAIR
+#define CSMA_FAIR CSMA_CONF_FAIR
+#else
+#define CSMA_FAIR 0
+#endif /* CSMA_CONF_FAIR */
+
+#if CSMA_FAIR
+struct csma_stats {
+  /* Packets accepted in a neighbor queue */
+  unsigned long queued;
+  /* Packets dropped because their neighbor queue was full */
+  unsigned long dropped_full;
+  /* Packets dropped for lack of a neighbor queue or a buffer */
+  unsigned long dropped_nobuf;
+  /* Queued packets dropped to make room for a shorter queue */
+  unsigned long pushed_out;
+  /* The longest neighbor queue seen */
+  unsigned int max_queue_len;
+};
+
+extern struct csma_stats csma_stats;
+
+/* The number of packets queued for a neighbor */
+int csma_queue_length(const linkaddr_t *addr);
+#endif /* CSMA_FAIR */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
@@ -74,6 +74,28 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+/* Probing stops at an empty slot, so there must always be one. */
+#error NBR_TABLE_CONF_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+
+#define NO_INDEX -1
+/* Open addressing (linear probing) index from link-layer address to
+ * neighbor index */
+static int16_t hash_index[NBR_TABLE_HASH_SIZE];
+/* Unlocked neighbors are kept on one LRU list per number of tables
+ * using them, least recently used first. The lists are linked through
+ * neighbor indices. Locked neighbors are on no list. */
+#define LRU_NONE 0xff
+static int16_t lru_next[NBR_TABLE_MAX_NEIGHBORS];
+static int16_t lru_prev[NBR_TABLE_MAX_NEIGHBORS];
+static uint8_t lru_class[NBR_TABLE_MAX_NEIGHBORS];
+static int16_t lru_head[MAX_NUM_TABLES + 1];
+static int16_t lru_tail[MAX_NUM_TABLES + 1];
+static uint8_t hash_initialized;
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -116,6 +138,129 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_HASH
+/*---------------------------------------------------------------------------*/
+static void
+hash_init(void)
+{
+  int i;
+
+  for(i = 0; i < NBR_TABLE_HASH_SIZE; i++) {
+    hash_index[i] = NO_INDEX;
+  }
+  for(i = 0; i <= MAX_NUM_TABLES; i++) {
+    lru_head[i] = lru_tail[i] = NO_INDEX;
+  }
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    lru_class[i] = LRU_NONE;
+  }
+  hash_initialized = 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+hash_slot(const linkaddr_t *lladdr)
+{
+  unsigned int h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(int index)
+{
+  int slot;
+
+  slot = hash_slot(&key_from_index(index)->lladdr);
+  while(hash_index[slot] != NO_INDEX) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = index;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(int index)
+{
+  int slot, next, home;
+
+  slot = hash_slot(&key_from_index(index)->lladdr);
+  while(hash_index[slot] != index) {
+    if(hash_index[slot] == NO_INDEX) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  /* Shift the following entries of the probe sequence back, so that
+   * lookups never need tombstones */
+  next = slot;
+  while(1) {
+    next = (next + 1) % NBR_TABLE_HASH_SIZE;
+    if(hash_index[next] == NO_INDEX) {
+      break;
+    }
+    home = hash_slot(&key_from_index(hash_index[next])->lladdr);
+    /* Move the entry unless its home slot lies cyclically in (slot, next] */
+    if((slot < next) ? (home <= slot || home > next)
+                     : (home <= slot && home > next)) {
+      hash_index[slot] = hash_index[next];
+      slot = next;
+    }
+  }
+  hash_index[slot] = NO_INDEX;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lru_remove(int index)
+{
+  uint8_t c = lru_class[index];
+
+  if(c == LRU_NONE) {
+    return;
+  }
+  if(lru_prev[index] != NO_INDEX) {
+    lru_next[lru_prev[index]] = lru_next[index];
+  } else {
+    lru_head[c] = lru_next[index];
+  }
+  if(lru_next[index] != NO_INDEX) {
+    lru_prev[lru_next[index]] = lru_prev[index];
+  } else {
+    lru_tail[c] = lru_prev[index];
+  }
+  lru_class[index] = LRU_NONE;
+}
+/*---------------------------------------------------------------------------*/
+/* Move a neighbor to the most recently used end of the list matching
+ * its used and locked bits */
+static void
+lru_update(int index)
+{
+  uint8_t c;
+  uint8_t used;
+
+  lru_remove(index);
+  if(locked_map[index]) {
+    return;
+  }
+  for(c = 0, used = used_map[index]; used != 0; used &= used - 1) {
+    c++;
+  }
+  lru_class[index] = c;
+  lru_next[index] = NO_INDEX;
+  lru_prev[index] = lru_tail[c];
+  if(lru_tail[c] != NO_INDEX) {
+    lru_next[lru_tail[c]] = index;
+  } else {
+    lru_head[c] = index;
+  }
+  lru_tail[c] = index;
+}
+#endif /* NBR_TABLE_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
@@ -127,6 +272,23 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  {
+    int slot;
+
+    if(!hash_initialized) {
+      return -1;
+    }
+    for(slot = hash_slot(lladdr); hash_index[slot] != NO_INDEX;
+        slot = (slot + 1) % NBR_TABLE_HASH_SIZE) {
+      key = key_from_index(hash_index[slot]);
+      if(linkaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_index[slot];
+      }
+    }
+    return -1;
+  }
+#endif /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -162,6 +324,9 @@ nbr_set_bit(uint8_t *bitmap, nbr_table_t *table, nbr_table_item_t *item, int val
     } else {
       bitmap[item_index] &= ~(1 << table->index);
     }
+#if NBR_TABLE_HASH
+    lru_update(item_index);
+#endif /* NBR_TABLE_HASH */
     return 1;
   } else {
     return 0;
@@ -173,7 +338,9 @@ static nbr_table_key_t *
 nbr_table_allocate(void)
 {
   nbr_table_key_t *key;
+#if !NBR_TABLE_HASH
   int least_used_count = 0;
+#endif /* !NBR_TABLE_HASH */
   nbr_table_key_t *least_used_key = NULL;
 
   key = memb_alloc(&neighbor_addr_mem);
@@ -185,6 +352,18 @@ nbr_table_allocate(void)
             * (2) used by fewest tables
             * (3) oldest (the list is ordered by insertion time)
             * */
+#if NBR_TABLE_HASH
+    int c;
+
+    /* (3) becomes least recently used: the head of the first
+     * non-empty LRU list is the neighbor to replace */
+    for(c = 0; c <= MAX_NUM_TABLES; c++) {
+      if(lru_head[c] != NO_INDEX) {
+        least_used_key = key_from_index(lru_head[c]);
+        break;
+      }
+    }
+#else /* NBR_TABLE_HASH */
     /* Get item from first key */
     key = list_head(nbr_table_keys);
     while(key != NULL) {
@@ -212,6 +391,7 @@ nbr_table_allocate(void)
       }
       key = list_item_next(key);
     }
+#endif /* NBR_TABLE_HASH */
     if(least_used_key == NULL) {
       /* We haven't found any unlocked item, allocation fails */
       return NULL;
@@ -229,6 +409,10 @@ nbr_table_allocate(void)
       }
       /* Empty used map */
       used_map[index_from_key(least_used_key)] = 0;
+#if NBR_TABLE_HASH
+      lru_remove(index_from_key(least_used_key));
+      hash_remove(index_from_key(least_used_key));
+#endif /* NBR_TABLE_HASH */
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
       /* Return associated key */
@@ -249,6 +433,11 @@ nbr_table_register(nbr_table_t *table, nbr_table_callback *callback)
     ctimer_set(&periodic_timer, CLOCK_SECOND * 60, handle_periodic_timer, NULL);
   }
 #endif
+#if NBR_TABLE_HASH
+  if(!hash_initialized) {
+    hash_init();
+  }
+#endif /* NBR_TABLE_HASH */
   if(num_tables < MAX_NUM_TABLES) {
     table->index = num_tables++;
     table->callback = callback;
@@ -318,6 +507,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(index);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -334,8 +526,15 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 {
-  void *item = item_from_index(table, index_from_lladdr(lladdr));
-  return nbr_get_bit(used_map, table, item) ? item : NULL;
+  int index = index_from_lladdr(lladdr);
+  void *item = item_from_index(table, index);
+  if(!nbr_get_bit(used_map, table, item)) {
+    return NULL;
+  }
+#if NBR_TABLE_HASH
+  lru_update(index);
+#endif /* NBR_TABLE_HASH */
+  return item;
 }
 /*---------------------------------------------------------------------------*/
 /* Removes a neighbor from the current table (unset "used" bit) */
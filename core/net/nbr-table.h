@@ -46,6 +46,23 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Index neighbors by a hash of their link-layer address, and replace
+ * the least recently used neighbor without scanning the table. Useful
+ * with a large NBR_TABLE_MAX_NEIGHBORS. */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 0
+#endif /* NBR_TABLE_CONF_HASH */
+
+/* Number of slots of the hash index, should be well above
+ * NBR_TABLE_MAX_NEIGHBORS to keep probe sequences short */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#else /* NBR_TABLE_CONF_HASH_SIZE */
+#define NBR_TABLE_HASH_SIZE (2 * NBR_TABLE_MAX_NEIGHBORS + 1)
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
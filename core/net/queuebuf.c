@@ -48,6 +48,11 @@
 #include "cfs/cfs.h"
 #endif
 
+#if QUEUEBUF_MMEM
+#include "lib/mmem.h"
+#include <stddef.h> /* for offsetof() */
+#endif
+
 #include <string.h> /* for memcpy() */
 
 /* Structure pointing to a buffer either stored
@@ -59,6 +64,9 @@ struct queuebuf {
   int line;
   clock_time_t time;
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_MMEM
+  struct mmem mem;
+#else /* QUEUEBUF_MMEM */
 #if WITH_SWAP
   enum {IN_RAM, IN_CFS} location;
   union {
@@ -68,18 +76,27 @@ struct queuebuf {
     int swap_id;
   };
 #endif
+#endif /* QUEUEBUF_MMEM */
 };
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+#if !QUEUEBUF_MMEM
   uint8_t data[PACKETBUF_SIZE];
+#endif /* !QUEUEBUF_MMEM */
   uint16_t len;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#if QUEUEBUF_MMEM
+  /* The frame, in a managed memory block that ends with it */
+  uint8_t data[];
+#endif /* QUEUEBUF_MMEM */
 };
 
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
+#if !QUEUEBUF_MMEM
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+#endif /* !QUEUEBUF_MMEM */
 
 #if WITH_SWAP
 
@@ -267,6 +284,38 @@ queuebuf_load_to_ram(struct queuebuf *b)
     }
   }
 }
+#elif QUEUEBUF_MMEM
+/*---------------------------------------------------------------------------*/
+static struct queuebuf_data *
+queuebuf_load_to_ram(struct queuebuf *b)
+{
+  return (struct queuebuf_data *)MMEM_PTR(&b->mem);
+}
+/*---------------------------------------------------------------------------*/
+/* Allocate a block for a frame of len bytes. The block may move when
+   managed memory is compacted, so it is always reached through
+   queuebuf_load_to_ram(). The size is rounded up so that the next
+   block, which managed memory may place right after this one, is
+   aligned for its struct queuebuf_data too. */
+#define QUEUEBUF_DATA_ALIGN (offsetof(struct queuebuf_data_align, data))
+struct queuebuf_data_align {
+  char c;
+  struct queuebuf_data data;
+};
+static unsigned int
+queuebuf_data_size(uint16_t len)
+{
+  unsigned int size;
+
+  size = sizeof(struct queuebuf_data) + len;
+  return (size + QUEUEBUF_DATA_ALIGN - 1) / QUEUEBUF_DATA_ALIGN *
+    QUEUEBUF_DATA_ALIGN;
+}
+static int
+queuebuf_alloc_data(struct queuebuf *b, uint16_t len)
+{
+  return mmem_alloc(&b->mem, queuebuf_data_size(len));
+}
 #else /* WITH_SWAP */
 /*---------------------------------------------------------------------------*/
 static struct queuebuf_data *
@@ -286,7 +335,11 @@ queuebuf_init(void)
     qbuf_renew_file(i);
   }
 #endif
+#if QUEUEBUF_MMEM
+  mmem_init();
+#else /* QUEUEBUF_MMEM */
   memb_init(&buframmem);
+#endif /* QUEUEBUF_MMEM */
   memb_init(&bufmem);
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
@@ -318,6 +371,14 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_MMEM
+    if(!queuebuf_alloc_data(buf, packetbuf_totlen())) {
+      PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
+      memb_free(&bufmem, buf);
+      return NULL;
+    }
+    buframptr = queuebuf_load_to_ram(buf);
+#else /* QUEUEBUF_MMEM */
     buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
@@ -338,6 +399,7 @@ queuebuf_new_from_packetbuf(void)
     }
     buframptr = buf->ram_ptr;
 #endif
+#endif /* QUEUEBUF_MMEM */
 
     buframptr->len = packetbuf_copyto(buframptr->data);
     packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
@@ -378,10 +440,33 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 #endif
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_MMEM
+  struct mmem_stats stats;
+  unsigned int size;
+
+  size = queuebuf_data_size(packetbuf_totlen());
+  if(size > buf->mem.size) {
+    /* The frame has grown, typically by its MAC header. The old
+       contents are not needed, so the block is freed first to let
+       the new one reuse its space. The free memory is checked
+       beforehand, with room for the alignment of managed memory, so
+       that the queuebuf keeps its old frame when the grow fails. */
+    mmem_get_stats(&stats);
+    if(stats.free + buf->mem.size <
+       (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *)) {
+      PRINTF("queuebuf_update_from_packetbuf: could not grow queuebuf data\n");
+      return 0;
+    }
+    mmem_free(&buf->mem);
+    /* Cannot fail after the check above */
+    mmem_alloc(&buf->mem, size);
+  }
+#endif /* QUEUEBUF_MMEM */
+  buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
@@ -389,13 +474,16 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
     queuebuf_flush_tmpdata();
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
   if(memb_inmemb(&bufmem, buf)) {
-#if WITH_SWAP
+#if QUEUEBUF_MMEM
+    mmem_free(&buf->mem);
+#elif WITH_SWAP
     if(buf->location == IN_RAM) {
       memb_free(&buframmem, buf->ram_ptr);
     } else {
@@ -79,6 +79,20 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_MMEM stores the queuebuf data in managed memory (see
+   lib/mmem.h), in a block sized to the queued frame instead of a
+   fixed PACKETBUF_SIZE buffer. The data of all queuebufs then shares
+   the MMEM_CONF_SIZE bytes of managed memory. */
+#ifdef QUEUEBUF_CONF_MMEM
+#define QUEUEBUF_MMEM QUEUEBUF_CONF_MMEM
+#else
+#define QUEUEBUF_MMEM 0
+#endif
+
+#if QUEUEBUF_MMEM && WITH_SWAP
+#error "QUEUEBUF_CONF_MMEM cannot be used with queuebuf swapping"
+#endif
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -96,7 +110,8 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
 void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
-void queuebuf_update_from_packetbuf(struct queuebuf *b);
+/* Returns 0, with the queuebuf unchanged, if the frame does not fit */
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -52,8 +52,94 @@
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_HEAP
+static struct etimer *heap[ETIMER_HEAP_SIZE];
+static uint16_t heap_len;
+
+/* Wrap-around safe comparison of the expiration times of two timers. */
+#define EXPIRES_BEFORE(a, b)                                            \
+  ((clock_time_t)(etimer_expiration_time(a) - etimer_expiration_time(b)) > \
+   ((clock_time_t)~0 >> 1))
+#endif /* ETIMER_HEAP */
+
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP
+static void
+heap_place(struct etimer *t, uint16_t i)
+{
+  heap[i] = t;
+  t->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_up(uint16_t i)
+{
+  struct etimer *t;
+  uint16_t parent;
+
+  t = heap[i];
+  while(i > 0) {
+    parent = (i - 1) / 2;
+    if(!EXPIRES_BEFORE(t, heap[parent])) {
+      break;
+    }
+    heap_place(heap[parent], i);
+    i = parent;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_down(uint16_t i)
+{
+  struct etimer *t;
+  uint16_t child;
+
+  t = heap[i];
+  while((child = 2 * i + 1) < heap_len) {
+    if(child + 1 < heap_len && EXPIRES_BEFORE(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if(!EXPIRES_BEFORE(heap[child], t)) {
+      break;
+    }
+    heap_place(heap[child], i);
+    i = child;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_fix(uint16_t i)
+{
+  if(i > 0 && EXPIRES_BEFORE(heap[i], heap[(i - 1) / 2])) {
+    heap_sift_up(i);
+  } else {
+    heap_sift_down(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+heap_contains(struct etimer *t)
+{
+  /* The index is only trusted if it points back to the timer, so that
+     timers that were never set can safely be checked. */
+  return t->heap_index < heap_len && heap[t->heap_index] == t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(uint16_t i)
+{
+  heap_len--;
+  if(i != heap_len) {
+    heap_place(heap[heap_len], i);
+    heap_fix(i);
+  }
+  heap[heap_len] = NULL;
+}
+#endif /* ETIMER_HEAP */
+/*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
@@ -61,14 +147,24 @@ update_time(void)
   clock_time_t now;
   struct etimer *t;
 
-  if (timerlist == NULL) {
+  if(!etimer_pending()) {
     next_expiration = 0;
   } else {
     now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
+#if ETIMER_HEAP
+    if(heap_len > 0) {
+      t = heap[0];
+      tdist = t->timer.start + t->timer.interval - now;
+      t = timerlist;
+    } else
+#endif /* ETIMER_HEAP */
+    {
+      t = timerlist;
+      /* Must calculate distance to next time into account due to wraps */
+      tdist = t->timer.start + t->timer.interval - now;
+      t = t->next;
+    }
+    for(; t != NULL; t = t->next) {
       if(t->timer.start + t->timer.interval - now < tdist) {
 	tdist = t->timer.start + t->timer.interval - now;
       }
@@ -84,6 +180,9 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_BEGIN();
 
   timerlist = NULL;
+#if ETIMER_HEAP
+  heap_len = 0;
+#endif /* ETIMER_HEAP */
   
   while(1) {
     PROCESS_YIELD();
@@ -91,6 +190,30 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
+#if ETIMER_HEAP
+      {
+        uint16_t i, j;
+
+        /* Drop the timers of the exited process and re-heapify the
+           remaining ones. */
+        for(i = j = 0; i < heap_len; i++) {
+          if(heap[i]->p != p) {
+            heap_place(heap[i], j++);
+          }
+        }
+        if(j != heap_len) {
+          for(i = j; i < heap_len; i++) {
+            heap[i] = NULL;
+          }
+          heap_len = j;
+          for(i = heap_len / 2; i > 0; i--) {
+            heap_sift_down(i - 1);
+          }
+          update_time();
+        }
+      }
+#endif /* ETIMER_HEAP */
+
       while(timerlist != NULL && timerlist->p == p) {
 	timerlist = timerlist->next;
       }
@@ -109,6 +232,22 @@ PROCESS_THREAD(etimer_process, ev, data)
       continue;
     }
 
+#if ETIMER_HEAP
+    /* Only the root of the heap has to be checked: if it has not
+       expired, no other timer in the heap has either. */
+    while(heap_len > 0 && timer_expired(&heap[0]->timer)) {
+      t = heap[0];
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        t->p = PROCESS_NONE;
+        heap_remove(0);
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+    update_time();
+#endif /* ETIMER_HEAP */
+
   again:
     
     u = NULL;
@@ -154,6 +293,16 @@ add_timer(struct etimer *timer)
 
   etimer_request_poll();
 
+#if ETIMER_HEAP
+  if(heap_contains(timer)) {
+    /* Timer already in the heap, move it to its new position. */
+    timer->p = PROCESS_CURRENT();
+    heap_fix(timer->heap_index);
+    update_time();
+    return;
+  }
+#endif /* ETIMER_HEAP */
+
   if(timer->p != PROCESS_NONE) {
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
@@ -167,6 +316,14 @@ add_timer(struct etimer *timer)
 
   /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
+#if ETIMER_HEAP
+  if(heap_len < ETIMER_HEAP_SIZE) {
+    heap_place(timer, heap_len);
+    heap_sift_up(heap_len++);
+    update_time();
+    return;
+  }
+#endif /* ETIMER_HEAP */
   timer->next = timerlist;
   timerlist = timer;
 
@@ -206,6 +363,11 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_HEAP
+  if(heap_contains(et)) {
+    heap_fix(et->heap_index);
+  }
+#endif /* ETIMER_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -230,6 +392,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_HEAP
+  if(heap_len > 0) {
+    return 1;
+  }
+#endif /* ETIMER_HEAP */
   return timerlist != NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -244,6 +411,12 @@ etimer_stop(struct etimer *et)
 {
   struct etimer *t;
 
+#if ETIMER_HEAP
+  if(heap_contains(et)) {
+    heap_remove(et->heap_index);
+    update_time();
+  } else
+#endif /* ETIMER_HEAP */
   /* First check if et is the first event timer on the list. */
   if(et == timerlist) {
     timerlist = timerlist->next;
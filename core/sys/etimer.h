@@ -65,6 +65,30 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * \brief Keep pending event timers in a binary min-heap
+ *
+ *        By default, pending event timers are kept on an unsorted
+ *        list, which makes setting, stopping and expiring timers
+ *        linear in the number of pending timers. With
+ *        ETIMER_CONF_HEAP set, up to ETIMER_CONF_HEAP_SIZE timers
+ *        are instead kept in a binary min-heap ordered by expiration
+ *        time, so that etimer_set() and etimer_stop() are O(log n)
+ *        and the next expiration time is found in O(1). Timers that
+ *        do not fit in the heap are kept on the unsorted list.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
+#ifdef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_HEAP_SIZE ETIMER_CONF_HEAP_SIZE
+#else /* ETIMER_CONF_HEAP_SIZE */
+#define ETIMER_HEAP_SIZE 64
+#endif /* ETIMER_CONF_HEAP_SIZE */
+
 /**
  * A timer.
  *
@@ -77,6 +101,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  uint16_t heap_index;
+#endif /* ETIMER_HEAP */
 };
 
 /**
@@ -63,10 +63,27 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS
+  clock_time_t posted;
+#endif /* PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS */
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * One event queue per priority. nevents is the total number of
+ * queued events.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  struct event_data events[PROCESS_CONF_NUMEVENTS];
+};
+
+#if PROCESS_PRIORITIES * PROCESS_CONF_NUMEVENTS > 255
+/* nevents counts the events of all queues in a process_num_events_t. */
+#error PROCESS_CONF_PRIORITIES * PROCESS_CONF_NUMEVENTS must not exceed 255
+#endif
+
+static process_num_events_t nevents;
+static struct event_queue queues[PROCESS_PRIORITIES];
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -74,6 +91,18 @@ process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
+#if PROCESS_PRIORITIES > 1
+/*
+ * Processes are spread over poll buckets. process_poll() flags the
+ * bucket of the process so that do_poll() only has to look at the
+ * processes of flagged buckets. One byte per bucket keeps setting a
+ * flag from an interrupt handler safe without atomic operations.
+ */
+static volatile unsigned char poll_buckets[PROCESS_POLL_BUCKETS];
+static struct process *bucket_list[PROCESS_POLL_BUCKETS];
+static unsigned char next_bucket;
+#endif /* PROCESS_PRIORITIES > 1 */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
@@ -113,6 +142,13 @@ process_start(struct process *p, process_data_t data)
   process_list = p;
   p->state = PROCESS_STATE_RUNNING;
   PT_INIT(&p->pt);
+#if PROCESS_PRIORITIES > 1
+  p->needspoll = 0;
+  p->bucket = next_bucket;
+  next_bucket = (next_bucket + 1) % PROCESS_POLL_BUCKETS;
+  p->pollnext = bucket_list[p->bucket];
+  bucket_list[p->bucket] = p;
+#endif /* PROCESS_PRIORITIES > 1 */
 
   PRINTF("process: starting '%s'\n", PROCESS_NAME_STRING(p));
 
@@ -168,6 +204,19 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_PRIORITIES > 1
+  if(p == bucket_list[p->bucket]) {
+    bucket_list[p->bucket] = p->pollnext;
+  } else {
+    for(q = bucket_list[p->bucket]; q != NULL; q = q->pollnext) {
+      if(q->pollnext == p) {
+        q->pollnext = p->pollnext;
+        break;
+      }
+    }
+  }
+#endif /* PROCESS_PRIORITIES > 1 */
+
   process_current = old_current;
 }
 /*---------------------------------------------------------------------------*/
@@ -187,6 +236,9 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS
+    p->events++;
+#endif /* PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS */
     ret = p->thread(&p->pt, ev, data);
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
@@ -207,9 +259,21 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+  }
+#if PROCESS_PRIORITIES > 1
+  for(i = 0; i < PROCESS_POLL_BUCKETS; i++) {
+    poll_buckets[i] = 0;
+    bucket_list[i] = NULL;
+  }
+  next_bucket = 0;
+#endif /* PROCESS_PRIORITIES > 1 */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -227,6 +291,27 @@ do_poll(void)
   struct process *p;
 
   poll_requested = 0;
+#if PROCESS_PRIORITIES > 1
+  {
+    int i;
+
+    /* Only visit the buckets that have a process to poll. The flag is
+       cleared before the bucket is walked, so a poll request that
+       comes in meanwhile is not lost. */
+    for(i = 0; i < PROCESS_POLL_BUCKETS; i++) {
+      if(poll_buckets[i]) {
+        poll_buckets[i] = 0;
+        for(p = bucket_list[i]; p != NULL; p = p->pollnext) {
+          if(p->needspoll) {
+            p->state = PROCESS_STATE_RUNNING;
+            p->needspoll = 0;
+            call_process(p, PROCESS_EVENT_POLL, NULL);
+          }
+        }
+      }
+    }
+  }
+#else /* PROCESS_PRIORITIES > 1 */
   /* Call the processes that needs to be polled. */
   for(p = process_list; p != NULL; p = p->next) {
     if(p->needspoll) {
@@ -235,6 +320,7 @@ do_poll(void)
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
+#endif /* PROCESS_PRIORITIES > 1 */
 }
 /*---------------------------------------------------------------------------*/
 /*
@@ -249,6 +335,7 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  static struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,16 +346,27 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* Take the event from the highest priority queue that has one. */
+    for(q = &queues[PROCESS_PRIORITIES - 1]; q->nevents == 0; q--);
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
+
+#if PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS
+    if(receiver != PROCESS_BROADCAST &&
+       clock_time() - q->events[q->fevent].posted > receiver->maxlatency) {
+      receiver->maxlatency = clock_time() - q->events[q->fevent].posted;
+    }
+#endif /* PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -322,6 +420,7 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +431,13 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+#if PROCESS_PRIORITIES > 1
+  q = &queues[p == PROCESS_BROADCAST ? PROCESS_PRIORITY_NORMAL : p->priority];
+#else /* PROCESS_PRIORITIES > 1 */
+  q = &queues[0];
+#endif /* PROCESS_PRIORITIES > 1 */
+
+  if(q->nevents == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,10 +448,14 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_NUMEVENTS;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+#if PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS
+  q->events[snum].posted = clock_time();
+#endif /* PROCESS_PRIORITIES > 1 && PROCESS_CONF_STATS */
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -374,11 +483,22 @@ process_poll(struct process *p)
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
       p->needspoll = 1;
+#if PROCESS_PRIORITIES > 1
+      poll_buckets[p->bucket] = 1;
+#endif /* PROCESS_PRIORITIES > 1 */
       poll_requested = 1;
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+#if PROCESS_PRIORITIES > 1
+  p->priority = priority < PROCESS_PRIORITIES ? priority : PROCESS_PRIORITY_HIGH;
+#endif /* PROCESS_PRIORITIES > 1 */
+}
+/*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
 {
@@ -88,6 +88,39 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \brief The number of event priorities
+ *
+ *        By default, all asynchronous events go through a single
+ *        FIFO queue. With PROCESS_CONF_PRIORITIES set above 1, each
+ *        priority gets its own queue of PROCESS_CONF_NUMEVENTS events
+ *        and events to higher priority processes are delivered
+ *        first. Broadcast events always use the lowest
+ *        priority. This scheduler also keeps pending polls in
+ *        PROCESS_CONF_POLL_BUCKETS buckets so that only the buckets
+ *        with polled processes are visited, and with
+ *        PROCESS_CONF_STATS set it counts events and the worst event
+ *        latency for each process.
+ */
+#ifdef PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIORITIES PROCESS_CONF_PRIORITIES
+#else /* PROCESS_CONF_PRIORITIES */
+#define PROCESS_PRIORITIES 1
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifdef PROCESS_CONF_POLL_BUCKETS
+#define PROCESS_POLL_BUCKETS PROCESS_CONF_POLL_BUCKETS
+#else /* PROCESS_CONF_POLL_BUCKETS */
+#define PROCESS_POLL_BUCKETS 8
+#endif /* PROCESS_CONF_POLL_BUCKETS */
+
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   (PROCESS_PRIORITIES - 1)
+
+#if PROCESS_PRIORITIES > 1
+#include "sys/clock.h"
+#endif /* PROCESS_PRIORITIES > 1 */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +356,14 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_PRIORITIES > 1
+  unsigned char priority, bucket;
+  struct process *pollnext;
+#if PROCESS_CONF_STATS
+  unsigned long events;
+  clock_time_t maxlatency;
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_PRIORITIES > 1 */
 };
 
 /**
@@ -452,6 +493,19 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+/**
+ * Set the priority of a process.
+ *
+ * Asynchronous events posted to the process are queued with this
+ * priority, between PROCESS_PRIORITY_NORMAL and
+ * PROCESS_PRIORITY_HIGH. Without PROCESS_CONF_PRIORITIES this
+ * function does nothing.
+ *
+ * \param p A pointer to the process' process structure.
+ * \param priority The new priority of the process.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+
 /** @} */
 
 /**
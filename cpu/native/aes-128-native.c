@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         AES-128 driver for the native platform
+ *
+ *         On x86 hosts whose CPU has AES-NI, each round is a single
+ *         instruction. Elsewhere, the T-table implementation is used.
+ */
+
+#include "aes-128-native.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_NI 1
+#include <immintrin.h>
+#else
+#define AES_NI 0
+#endif
+
+#if AES_NI
+/* 1 if the CPU has AES-NI, 0 if not, -1 until set_key() checks it */
+static int has_aes_ni = -1;
+
+static __m128i round_keys[11];
+
+/*---------------------------------------------------------------------------*/
+__attribute__((target("aes,sse2")))
+static __m128i
+expand_key(__m128i key, __m128i assist)
+{
+  assist = _mm_shuffle_epi32(assist, 0xff);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+/* The round constant has to be an immediate operand. */
+#define EXPAND_KEY(i, rcon) \
+  round_keys[i] = expand_key(round_keys[i - 1], \
+                             _mm_aeskeygenassist_si128(round_keys[i - 1], rcon))
+/*---------------------------------------------------------------------------*/
+__attribute__((target("aes,sse2")))
+static void
+aes_ni_set_key(const uint8_t *key)
+{
+  round_keys[0] = _mm_loadu_si128((const __m128i *)key);
+  EXPAND_KEY(1, 0x01);
+  EXPAND_KEY(2, 0x02);
+  EXPAND_KEY(3, 0x04);
+  EXPAND_KEY(4, 0x08);
+  EXPAND_KEY(5, 0x10);
+  EXPAND_KEY(6, 0x20);
+  EXPAND_KEY(7, 0x40);
+  EXPAND_KEY(8, 0x80);
+  EXPAND_KEY(9, 0x1b);
+  EXPAND_KEY(10, 0x36);
+}
+/*---------------------------------------------------------------------------*/
+__attribute__((target("aes,sse2")))
+static void
+aes_ni_encrypt(uint8_t *state)
+{
+  __m128i s;
+  int round;
+
+  s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)state), round_keys[0]);
+  for(round = 1; round < 10; round++) {
+    s = _mm_aesenc_si128(s, round_keys[round]);
+  }
+  s = _mm_aesenclast_si128(s, round_keys[10]);
+  _mm_storeu_si128((__m128i *)state, s);
+}
+#endif /* AES_NI */
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+#if AES_NI
+  if(has_aes_ni < 0) {
+    __builtin_cpu_init();
+    has_aes_ni = __builtin_cpu_supports("aes") != 0;
+  }
+  if(has_aes_ni) {
+    aes_ni_set_key(key);
+    return;
+  }
+#endif /* AES_NI */
+  aes_128_ttable_driver.set_key(key);
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *plaintext_and_result)
+{
+#if AES_NI
+  if(has_aes_ni > 0) {
+    aes_ni_encrypt(plaintext_and_result);
+    return;
+  }
+#endif /* AES_NI */
+  aes_128_ttable_driver.encrypt(plaintext_and_result);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver native_aes_128_driver = {
+  set_key,
+  encrypt
+};
+/*---------------------------------------------------------------------------*/
@@ -42,6 +42,17 @@
 
 #include "tapdev-drv.h"
 
+#if UIP_PACKET_POOL
+#include "net/ip/uip-packetpool.h"
+
+/* The number of frames read ahead on each poll */
+#ifdef TAPDEV_CONF_BATCH
+#define TAPDEV_BATCH TAPDEV_CONF_BATCH
+#else
+#define TAPDEV_BATCH (UIP_PACKET_POOL - 1)
+#endif
+#endif /* UIP_PACKET_POOL */
+
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
 #define IPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
@@ -59,10 +70,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +97,48 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+#if UIP_PACKET_POOL
+  uip_buf_t *frames[TAPDEV_BATCH];
+  uint16_t lens[TAPDEV_BATCH];
+  int i, n;
+
+  if(uip_packetpool_numfree() == 0) {
+    /* Every other buffer is parked: handle one frame in place. */
+    uip_len = tapdev_poll();
+    input();
+    return;
+  }
+
+  /* Read all the frames that are ready, each into its own buffer,
+     before processing them. Frames the pool has no room for are left
+     to the next poll. */
+  for(n = 0; n < TAPDEV_BATCH && uip_packetpool_numfree() > 0; n++) {
+    uip_len = tapdev_poll();
+    if(uip_len == 0) {
+      break;
+    }
+    lens[n] = uip_len;
+    frames[n] = uip_packetpool_detach();
+  }
+
+  for(i = 0; i < n; i++) {
+    uip_packetpool_attach(frames[i]);
+    uip_len = lens[i];
+    input();
+  }
+
+  if(n == TAPDEV_BATCH) {
+    process_poll(&tapdev_process);
+  }
+#else /* UIP_PACKET_POOL */
+  uip_len = tapdev_poll();
+  input();
+#endif /* UIP_PACKET_POOL */
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Native implementation of the uIP checksum functions
+ *
+ *         The data is summed in host byte order, a word at a time,
+ *         into a wide accumulator whose carries are only folded back
+ *         at the end (RFC 1071). On x86 hosts, SSE2 or AVX2 is used
+ *         when the CPU supports it.
+ */
+
+#include "net/ip/uip.h"
+#include "net/ip/uip_arch.h"
+
+#include <string.h>
+
+#if UIP_ARCH_CHKSUM
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHKSUM_X86 1
+#include <immintrin.h>
+#else
+#define CHKSUM_X86 0
+#endif
+
+#define BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint64_t chksum_select(const uint8_t *data, uint16_t len);
+
+/* The summing function, chosen at the first call */
+static uint64_t (*chksum_words)(const uint8_t *data, uint16_t len) = chksum_select;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+chksum_scalar(const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+  uint64_t w;
+  uint16_t t;
+
+  acc = 0;
+  while(len >= sizeof(w)) {
+    memcpy(&w, data, sizeof(w));
+    acc += (w & 0xffffffff) + (w >> 32);
+    data += sizeof(w);
+    len -= sizeof(w);
+  }
+  while(len >= sizeof(t)) {
+    memcpy(&t, data, sizeof(t));
+    acc += t;
+    data += sizeof(t);
+    len -= sizeof(t);
+  }
+  if(len > 0) {
+    /* The last byte is the high byte of a word in network byte order. */
+    t = 0;
+    memcpy(&t, data, 1);
+    acc += t;
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+#if CHKSUM_X86
+/*
+ * The 16-bit words are widened to 32-bit lanes. As len is at most
+ * 65535, no lane can overflow, so carries never need to be handled in
+ * the loop.
+ */
+__attribute__((target("sse2")))
+static uint64_t
+chksum_sse2(const uint8_t *data, uint16_t len)
+{
+  __m128i acc, v, zero;
+  uint32_t lanes[4];
+
+  zero = _mm_setzero_si128();
+  acc = zero;
+  while(len >= 16) {
+    v = _mm_loadu_si128((const __m128i *)data);
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+    data += 16;
+    len -= 16;
+  }
+  _mm_storeu_si128((__m128i *)lanes, acc);
+  return (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+    chksum_scalar(data, len);
+}
+/*---------------------------------------------------------------------------*/
+__attribute__((target("avx2")))
+static uint64_t
+chksum_avx2(const uint8_t *data, uint16_t len)
+{
+  __m256i acc, v, zero;
+  uint32_t lanes[8];
+  int i;
+  uint64_t sum;
+
+  zero = _mm256_setzero_si256();
+  acc = zero;
+  while(len >= 32) {
+    v = _mm256_loadu_si256((const __m256i *)data);
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+    acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+    data += 32;
+    len -= 32;
+  }
+  _mm256_storeu_si256((__m256i *)lanes, acc);
+  sum = chksum_scalar(data, len);
+  for(i = 0; i < 8; i++) {
+    sum += lanes[i];
+  }
+  return sum;
+}
+#endif /* CHKSUM_X86 */
+/*---------------------------------------------------------------------------*/
+static uint64_t
+chksum_select(const uint8_t *data, uint16_t len)
+{
+  chksum_words = chksum_scalar;
+#if CHKSUM_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    chksum_words = chksum_avx2;
+  } else if(__builtin_cpu_supports("sse2")) {
+    chksum_words = chksum_sse2;
+  }
+#endif /* CHKSUM_X86 */
+  return chksum_words(data, len);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+
+  /* Sum in host byte order, which only swaps the bytes of the result. */
+  acc = uip_htons(sum) + chksum_words(data, len);
+
+  /* Fold the carries back. */
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Return sum in host byte order. */
+  return uip_ntohs((uint16_t)acc);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum(uint16_t *data, uint16_t len)
+{
+  return uip_htons(chksum(0, (uint8_t *)data, len));
+}
+/*---------------------------------------------------------------------------*/
+#ifndef UIP_ARCH_IPCHKSUM
+uint16_t
+uip_ipchksum(void)
+{
+  uint16_t sum;
+
+  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+#endif
+/*---------------------------------------------------------------------------*/
+static uint16_t
+upper_layer_chksum(uint8_t proto)
+{
+  uint16_t upper_layer_len;
+  uint16_t sum;
+
+#if NETSTACK_CONF_WITH_IPV6
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1] - uip_ext_len);
+#else /* NETSTACK_CONF_WITH_IPV6 */
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1]) - UIP_IPH_LEN;
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+
+  /* First sum pseudoheader. */
+  /* IP protocol and length fields. This addition cannot carry. */
+  sum = upper_layer_len + proto;
+  /* Sum IP source and destination addresses. */
+  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+
+  /* Sum TCP header and data. */
+#if NETSTACK_CONF_WITH_IPV6
+  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+               upper_layer_len);
+#else /* NETSTACK_CONF_WITH_IPV6 */
+  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN], upper_layer_len);
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+#if NETSTACK_CONF_WITH_IPV6
+uint16_t
+uip_icmp6chksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_ICMP6);
+}
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+uint16_t
+uip_tcpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_TCP);
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP && UIP_UDP_CHECKSUMS
+uint16_t
+uip_udpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_UDP);
+}
+#endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_ARCH_CHKSUM */
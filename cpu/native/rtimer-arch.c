@@ -46,6 +46,14 @@
 #include "sys/rtimer.h"
 #include "sys/clock.h"
 
+#if RTIMER_ARCH_TIMERFD
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif /* RTIMER_ARCH_TIMERFD */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,6 +62,80 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_ARCH_TIMERFD
+static int timer_fd = -1;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+monotonic_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  return (rtimer_clock_t)monotonic_us();
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_arch_fd(void)
+{
+  return timer_fd;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_run(void)
+{
+  uint64_t expirations;
+
+  /* The timer is non-blocking, so a spurious wakeup fails with EAGAIN */
+  if(read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+    rtimer_run_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_init(void)
+{
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(timer_fd < 0) {
+    perror("rtimer: timerfd_create");
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  struct itimerspec val;
+  uint64_t now;
+  uint64_t expiry;
+
+  /* Extend the wrapping rtimer time to the full monotonic time */
+  now = monotonic_us();
+  if(RTIMER_CLOCK_LT(t, (rtimer_clock_t)now)) {
+    expiry = now - (rtimer_clock_t)((rtimer_clock_t)now - t);
+  } else {
+    expiry = now + (rtimer_clock_t)(t - (rtimer_clock_t)now);
+  }
+
+  /* A zero expiry would disarm the timer, and one in the past fires at once */
+  val.it_value.tv_sec = expiry / 1000000;
+  val.it_value.tv_nsec = (expiry % 1000000) * 1000;
+  if(val.it_value.tv_sec == 0 && val.it_value.tv_nsec == 0) {
+    val.it_value.tv_nsec = 1;
+  }
+  val.it_interval.tv_sec = val.it_interval.tv_nsec = 0;
+
+  PRINTF("rtimer_arch_schedule time %lu in %ld us\n", (unsigned long)t,
+         (long)(expiry - now));
+
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &val, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_ARCH_TIMERFD */
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -77,8 +159,13 @@ rtimer_arch_schedule(rtimer_clock_t t)
   struct itimerval val;
   rtimer_clock_t c;
 
-  c = t - (unsigned short)clock_time();
-  
+  c = t - (rtimer_clock_t)clock_time();
+  /* A deadline that has already passed fires as soon as possible instead
+     of after the clock wraps around; a zero timer would be disarmed */
+  if(RTIMER_CLOCK_LT(t, (rtimer_clock_t)clock_time()) || c == 0) {
+    c = 1;
+  }
+
   val.it_value.tv_sec = c / 1000;
   val.it_value.tv_usec = (c % 1000) * 1000;
 
@@ -90,3 +177,4 @@ rtimer_arch_schedule(rtimer_clock_t t)
 #endif /* !_WIN32 */
 }
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_ARCH_TIMERFD */
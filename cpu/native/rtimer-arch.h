@@ -42,8 +42,36 @@
 
 #include "contiki-conf.h"
 
+/*
+ * With RTIMER_ARCH_TIMERFD, rtimers count microseconds of CLOCK_MONOTONIC
+ * and expire through a timerfd that the platform main loop watches
+ * (see rtimer_arch_fd() and rtimer_arch_run()). Otherwise they count
+ * clock_time() ticks and expire from a SIGALRM handler.
+ */
+#ifdef RTIMER_ARCH_CONF_TIMERFD
+#define RTIMER_ARCH_TIMERFD RTIMER_ARCH_CONF_TIMERFD
+#else
+#define RTIMER_ARCH_TIMERFD 0
+#endif
+
+#if RTIMER_ARCH_TIMERFD
+
+#define RTIMER_ARCH_SECOND 1000000
+
+rtimer_clock_t rtimer_arch_now(void);
+
+/* The file descriptor that becomes readable when the rtimer expires */
+int rtimer_arch_fd(void);
+
+/* Runs the next rtimer if the timer file descriptor has expired */
+void rtimer_arch_run(void);
+
+#else /* RTIMER_ARCH_TIMERFD */
+
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
 
 #define rtimer_arch_now() clock_time()
 
+#endif /* RTIMER_ARCH_TIMERFD */
+
 #endif /* RTIMER_ARCH_H_ */
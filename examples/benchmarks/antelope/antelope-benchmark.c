@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of Antelope queries on the native platform: a full
+ *         scan, an indexed range search, and an aggregate over relations
+ *         of 10000 to 100000 rows. The errors reported include failed
+ *         queries and wrong results.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+static const unsigned long row_counts[] = { 10000, 50000, 100000 };
+#define NUM_ROW_COUNTS (sizeof(row_counts) / sizeof(row_counts[0]))
+
+/* The width of the indexed range, in rows */
+#define RANGE 1000
+
+/* The values of the non-indexed attribute are below MAX_VALUE. */
+#define MAX_VALUE 1000
+
+static db_handle_t handle;
+static unsigned long matches, steps;
+static long first_value;
+/*---------------------------------------------------------------------------*/
+/* Runs a query to the end and returns the elapsed time in microseconds. */
+static unsigned long
+execute(const char *query, unsigned *errors)
+{
+  rtimer_clock_t start;
+  attribute_value_t value;
+  db_result_t result;
+
+  matches = steps = 0;
+  first_value = -1;
+
+  start = RTIMER_NOW();
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    (*errors)++;
+    return 0;
+  }
+
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    steps++;
+    if(result == DB_GOT_ROW) {
+      if(matches++ == 0 &&
+         !DB_ERROR(db_get_value(&value, &handle, 0))) {
+        first_value = db_value_to_long(&value);
+      }
+    } else if(result == DB_FINISHED) {
+      break;
+    } else if(DB_ERROR(result)) {
+      printf("Processing \"%s\" failed: %s\n", query,
+             db_get_result_message(result));
+      (*errors)++;
+      break;
+    }
+  }
+  db_free(&handle);
+
+  return (unsigned long)((unsigned long long)(RTIMER_NOW() - start) *
+                         1000000 / RTIMER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_benchmark_process, "Antelope benchmark");
+AUTOSTART_PROCESSES(&antelope_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_benchmark_process, ev, data)
+{
+  static char query[AQL_MAX_QUERY_LENGTH];
+  static unsigned long rows, row, expected_matches;
+  static unsigned i, errors;
+  static long max_value;
+  unsigned long us;
+  unsigned value;
+
+  PROCESS_BEGIN();
+
+  printf("Antelope benchmark: DB_SCAN_BLOCK_SIZE %d\n", DB_SCAN_BLOCK_SIZE);
+
+  db_init();
+  random_init(1);
+
+  for(i = 0; i < NUM_ROW_COUNTS; i++) {
+    rows = row_counts[i];
+    errors = 0;
+    expected_matches = 0;
+    max_value = 0;
+
+    db_query(NULL, "REMOVE RELATION bench;");
+    if(DB_ERROR(db_query(NULL, "CREATE RELATION bench;")) ||
+       DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN LONG IN bench;")) ||
+       DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN bench;")) ||
+       DB_ERROR(db_query(NULL, "CREATE INDEX bench.id TYPE INLINE;"))) {
+      printf("Failed to create the relation\n");
+      errors++;
+    }
+
+    for(row = 0; row < rows; row++) {
+      value = random_rand() % MAX_VALUE;
+      if(value == 7) {
+        expected_matches++;
+      }
+      if(value > max_value) {
+        max_value = value;
+      }
+      snprintf(query, sizeof(query), "INSERT (%lu, %u) INTO bench;",
+               row, value);
+      if(DB_ERROR(db_query(NULL, query))) {
+        errors++;
+      }
+    }
+
+    us = execute("SELECT id, value FROM bench WHERE value = 7;", &errors);
+    if(matches != expected_matches) {
+      errors++;
+    }
+    printf("%6lu rows: full scan %7lu us (%lu steps),", rows, us, steps);
+
+    snprintf(query, sizeof(query),
+             "SELECT id FROM bench WHERE id > %lu AND id < %lu;",
+             rows / 2, rows / 2 + RANGE);
+    us = execute(query, &errors);
+    if(matches != RANGE - 1 || first_value != rows / 2 + 1) {
+      errors++;
+    }
+    printf(" range %6lu us (%lu steps),", us, steps);
+
+    us = execute("SELECT MAX(value) FROM bench;", &errors);
+    if(matches != 1 || first_value != max_value) {
+      errors++;
+    }
+    printf(" aggregate %7lu us (%lu steps), %u errors\n", us, steps, errors);
+  }
+
+  db_query(NULL, "REMOVE RELATION bench;");
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
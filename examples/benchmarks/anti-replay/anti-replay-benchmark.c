@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the llsec anti-replay check: a neighbor's frames
+ *         arrive partly out of order, as when retransmissions or other
+ *         paths delay some of them, mixed with replays of frames that
+ *         were received already. Reports how many genuine frames are
+ *         rejected and how many replays get through.
+ */
+
+#include "contiki.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/packetbuf.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Number of frames the neighbor sends in each scenario. The checks
+   are too short for the rtimer, so all of them are timed together,
+   including setting packetbuf up. */
+#ifndef FRAMES
+#define FRAMES 20000
+#endif
+
+/* One frame in REPLAY_INTERVAL is followed by a replay of an earlier
+   one, up to REPLAY_MAX_AGE frames back. */
+#define REPLAY_INTERVAL 10
+#define REPLAY_MAX_AGE 100
+
+/* A scenario: each frame is delayed with the given probability, in
+   percent, by up to max_delay frames. */
+struct scenario {
+  uint8_t percent;
+  uint8_t max_delay;
+};
+
+static const struct scenario scenarios[] = {
+  { 0, 0 }, { 1, 4 }, { 5, 4 }, { 20, 4 }, { 5, 16 }, { 5, 48 }
+};
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/* The frames in the order they arrive */
+struct arrival {
+  uint32_t time;
+  uint32_t counter;
+};
+static struct arrival arrivals[FRAMES];
+
+static const linkaddr_t neighbor = { { 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+static struct anti_replay_info info;
+/*---------------------------------------------------------------------------*/
+static int
+arrival_cmp(const void *a, const void *b)
+{
+  const struct arrival *x = a;
+  const struct arrival *y = b;
+
+  if(x->time != y->time) {
+    return x->time < y->time ? -1 : 1;
+  }
+  return x->counter < y->counter ? -1 : x->counter > y->counter;
+}
+/*---------------------------------------------------------------------------*/
+/* Receive a unicast frame with the given counter from the neighbor */
+static int
+receive(uint32_t counter)
+{
+  frame802154_frame_counter_t reordered_counter;
+
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &neighbor);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  reordered_counter.u32 = LLSEC802154_HTONL(counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, reordered_counter.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, reordered_counter.u16[1]);
+  return anti_replay_was_replayed(&info);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(anti_replay_benchmark_process, "Anti-replay benchmark");
+AUTOSTART_PROCESSES(&anti_replay_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(anti_replay_benchmark_process, ev, data)
+{
+  const struct scenario *s;
+  unsigned long dropped, replays, accepted_replays, checks;
+  unsigned long long ticks;
+  rtimer_clock_t start;
+  unsigned i;
+  uint32_t n;
+
+  PROCESS_BEGIN();
+
+  printf("anti-replay benchmark: ANTI_REPLAY_WINDOW %d, %d frames per scenario\n",
+         ANTI_REPLAY_WINDOW, FRAMES);
+
+  random_init(1);
+  for(i = 0; i < NUM_SCENARIOS; i++) {
+    s = &scenarios[i];
+
+    /* The neighbor sends the frames one time unit apart */
+    for(n = 0; n < FRAMES; n++) {
+      arrivals[n].counter = n + 1;
+      arrivals[n].time = n;
+      if(s->max_delay > 0 && random_rand() % 100 < s->percent) {
+        arrivals[n].time += 1 + random_rand() % s->max_delay;
+      }
+    }
+    qsort(arrivals, FRAMES, sizeof(struct arrival), arrival_cmp);
+
+    /* The first frame from the neighbor sets its counters up */
+    receive(arrivals[0].counter);
+    anti_replay_init_info(&info);
+
+    dropped = replays = accepted_replays = checks = 0;
+    start = RTIMER_NOW();
+    for(n = 1; n < FRAMES; n++) {
+      if(receive(arrivals[n].counter)) {
+        dropped++;
+      }
+      checks++;
+      if(n % REPLAY_INTERVAL == 0) {
+        replays++;
+        if(!receive(arrivals[n - random_rand() % MIN(n, REPLAY_MAX_AGE)].counter)) {
+          accepted_replays++;
+        }
+        checks++;
+      }
+    }
+    ticks = (rtimer_clock_t)(RTIMER_NOW() - start);
+    printf("%2u%% delayed by up to %2u frames: %lu genuine frames rejected, "
+           "%lu of %lu replays accepted, %lu ns per check\n",
+           s->percent, s->max_delay, dropped, accepted_replays, replays,
+           (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / checks));
+  }
+#if ANTI_REPLAY_WINDOW
+  printf("reordered %lu, replayed %lu, too old %lu\n",
+         anti_replay_stats.reordered, anti_replay_stats.replayed,
+         anti_replay_stats.too_old);
+#endif /* ANTI_REPLAY_WINDOW */
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Checks the uIP checksum functions of the platform against
+ *         the generic implementation on random data, then measures
+ *         the throughput of both.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Number of random inputs checked */
+#define FUZZ_ROUNDS 200000UL
+
+/* Number of bytes summed for each throughput measurement */
+#define VOLUME (256UL * 1024 * 1024)
+
+static uint8_t buf[UIP_BUFSIZE + 8];
+/*---------------------------------------------------------------------------*/
+/* The generic checksum of core/net/ipv6/uip6.c */
+static uint16_t
+ref_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {   /* At least two more bytes */
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ref_udpchksum(void)
+{
+  uint16_t len;
+  uint16_t sum;
+
+  len = ((uint16_t)(BUF->len[0]) << 8) + BUF->len[1];
+  sum = len + UIP_PROTO_UDP;
+  sum = ref_chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = ref_chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN], len);
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint8_t *p, uint16_t len)
+{
+  uint16_t i;
+  uint8_t v;
+
+  /* Mix runs of 0x00 and 0xff with random bytes to exercise the carries. */
+  v = random_rand();
+  for(i = 0; i < len; i++) {
+    switch(v & 3) {
+    case 0:
+      p[i] = 0;
+      break;
+    case 1:
+      p[i] = 0xff;
+      break;
+    default:
+      p[i] = random_rand();
+    }
+    if((random_rand() & 15) == 0) {
+      v = random_rand();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+fuzz(void)
+{
+  unsigned long n, errors;
+  uint16_t offset, len;
+
+  errors = 0;
+  for(n = 0; n < FUZZ_ROUNDS; n++) {
+    /* uip_chksum() on any alignment and length */
+    offset = random_rand() % 8;
+    len = random_rand() % (UIP_BUFSIZE + 1);
+    fill(buf + offset, len);
+    if(uip_chksum((uint16_t *)(buf + offset), len) !=
+       uip_htons(ref_chksum(0, buf + offset, len))) {
+      printf("uip_chksum mismatch: offset %u, length %u\n", offset, len);
+      errors++;
+    }
+
+    /* uip_udpchksum() on a random UDP packet */
+    len = random_rand() % (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN + 1);
+    fill(uip_buf, UIP_LLH_LEN + UIP_IPH_LEN + len);
+    BUF->len[0] = len >> 8;
+    BUF->len[1] = len & 0xff;
+    uip_ext_len = 0;
+    if(uip_udpchksum() != ref_udpchksum()) {
+      printf("uip_udpchksum mismatch: length %u\n", len);
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static void
+throughput(uint16_t len)
+{
+  clock_time_t start, ref, arch;
+  unsigned long n, rounds;
+  volatile uint16_t sum;
+
+  rounds = VOLUME / len;
+  fill(buf, len);
+
+  start = clock_time();
+  for(n = 0; n < rounds; n++) {
+    sum = ref_chksum(0, buf, len);
+  }
+  ref = clock_time() - start;
+
+  start = clock_time();
+  for(n = 0; n < rounds; n++) {
+    sum = uip_chksum((uint16_t *)buf, len);
+  }
+  arch = clock_time() - start;
+  (void)sum;
+
+  printf("%4u bytes: generic %lu MB/s, platform %lu MB/s\n", len,
+         ref > 0 ? VOLUME / 1000 / ref : 0,
+         arch > 0 ? VOLUME / 1000 / arch : 0);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(chksum_benchmark_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_benchmark_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("chksum benchmark: UIP_ARCH_CHKSUM %d\n", UIP_ARCH_CHKSUM);
+
+  random_init(0);
+  printf("fuzz: %lu inputs, %lu errors\n", FUZZ_ROUNDS, fuzz());
+
+  throughput(40);
+  throughput(100);
+  throughput(1280);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of Coffee on the native xmem emulation: the latency
+ *         of opening files in file systems with 10 to 500 files, of
+ *         finding the end of a large log after a reboot, of small
+ *         sequential and random reads, and of writes that need garbage
+ *         collection. The errors reported include files that are still
+ *         found after being removed, or not found after others have
+ *         been removed, reads of wrong data, and failed writes.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The opens are too short for the rtimer, so they are timed in
+   batches of OPENS. */
+#define OPENS 5000
+
+/* Reserved size of each file */
+#define FILE_SIZE 64
+
+static const unsigned file_counts[] = { 10, 50, 100, 250, 500 };
+#define NUM_FILE_COUNTS (sizeof(file_counts) / sizeof(file_counts[0]))
+
+/* A log of LOG_SIZE bytes, of which LOG_DATA bytes have been written,
+   is opened REOPENS times after a reboot. */
+#define LOG_SIZE (64 * 1024UL)
+#define LOG_DATA 4096
+#define REOPENS 200
+
+/* A file of READ_FILE_SIZE bytes is read in reads of READ_SIZE bytes,
+   READ_PASSES times sequentially and as many times at random offsets. */
+#define READ_FILE_SIZE (16 * 1024UL)
+#define READ_SIZE 32
+#define READ_PASSES 50
+#define READS (READ_PASSES * (READ_FILE_SIZE / READ_SIZE))
+
+/* ROTATIONS files are created in turn and written with ROTATE_SIZE
+   bytes, which is more than the default reservation, so that the
+   writes extend them. Each new file replaces the file created
+   ROTATE_LIVE files earlier. */
+#define ROTATE_SIZE (24 * 1024UL)
+#define ROTATE_LIVE 12
+#define ROTATIONS 400
+/*---------------------------------------------------------------------------*/
+static void
+file_name(char *name, unsigned i)
+{
+  sprintf(name, "file-%u", i);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char
+pattern(unsigned long offset)
+{
+  return (unsigned char)(offset * 7 + (offset >> 8) + 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Reads READ_SIZE bytes at an offset and checks them. */
+static unsigned
+read_at(int fd, unsigned long offset)
+{
+  unsigned char buf[READ_SIZE];
+
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, buf, sizeof(buf)) != sizeof(buf) ||
+     buf[0] != pattern(offset) ||
+     buf[sizeof(buf) - 1] != pattern(offset + sizeof(buf) - 1)) {
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_reads(const char *what, unsigned long long ticks, unsigned errors)
+{
+#if COFFEE_READ_CACHE_PAGES
+  static unsigned long last_hits, last_misses;
+  unsigned long hits, misses;
+#endif
+
+  printf("%s reads: %lu ns per read, %lu KB/s", what,
+         (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / READS),
+         (unsigned long)((unsigned long long)READS * READ_SIZE *
+                         RTIMER_SECOND / 1024 / (ticks ? ticks : 1)));
+#if COFFEE_READ_CACHE_PAGES
+  cfs_coffee_get_cache_stats(&hits, &misses);
+  printf(", %lu hits, %lu misses", hits - last_hits, misses - last_misses);
+  last_hits = hits;
+  last_misses = misses;
+#endif
+  printf(", %u errors\n", errors);
+}
+/*---------------------------------------------------------------------------*/
+/* Clears the RAM state of Coffee, as a reboot does. */
+static void
+reboot(void)
+{
+  unsigned size;
+  void *mem;
+
+  mem = cfs_coffee_get_protected_mem(&size);
+  memset(mem, 0, size);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns(rtimer_clock_t ticks, unsigned long n)
+{
+  return (unsigned long)((unsigned long long)ticks * 1000000000 / RTIMER_SECOND / n);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_benchmark_process, "Coffee benchmark");
+AUTOSTART_PROCESSES(&coffee_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_benchmark_process, ev, data)
+{
+  char name[16];
+  unsigned char buf[64];
+  rtimer_clock_t start, create_ticks, open_ticks, missing_ticks;
+  unsigned long long log_ticks;
+  static struct cfs_coffee_gc_stats gc_start, gc_end;
+  static unsigned long long file_ticks;
+  static rtimer_clock_t worst_write, worst_file;
+  static unsigned rotation, rotate_errors;
+  rtimer_clock_t write_start, ticks;
+  unsigned files, errors;
+  unsigned i, n;
+  int fd, wfd;
+
+  PROCESS_BEGIN();
+
+  printf("Coffee benchmark: COFFEE_DIR_CACHE_SIZE %d, COFFEE_EOF_RECORDS %d, "
+         "COFFEE_READ_CACHE_PAGES %d, COFFEE_BACKGROUND_GC %d, %d opens\n",
+         COFFEE_DIR_CACHE_SIZE, COFFEE_EOF_RECORDS, COFFEE_READ_CACHE_PAGES,
+         COFFEE_BACKGROUND_GC, OPENS);
+
+  random_init(1);
+  for(i = 0; i < NUM_FILE_COUNTS; i++) {
+    files = file_counts[i];
+    errors = 0;
+    cfs_coffee_format();
+
+    start = RTIMER_NOW();
+    for(n = 0; n < files; n++) {
+      file_name(name, n);
+      if(cfs_coffee_reserve(name, FILE_SIZE) < 0) {
+        errors++;
+      }
+    }
+    create_ticks = RTIMER_NOW() - start;
+
+    /* Open existing files in random order. */
+    start = RTIMER_NOW();
+    for(n = 0; n < OPENS; n++) {
+      file_name(name, random_rand() % files);
+      fd = cfs_open(name, CFS_READ);
+      if(fd < 0) {
+        errors++;
+      }
+      cfs_close(fd);
+    }
+    open_ticks = RTIMER_NOW() - start;
+
+    /* Look up files that do not exist, as when a file is created. */
+    start = RTIMER_NOW();
+    for(n = 0; n < OPENS; n++) {
+      file_name(name, files + random_rand() % files);
+      fd = cfs_open(name, CFS_READ);
+      if(fd >= 0) {
+        errors++;
+        cfs_close(fd);
+      }
+    }
+    missing_ticks = RTIMER_NOW() - start;
+
+    /* Remove every other file and check that the rest are found. */
+    for(n = 0; n < files; n += 2) {
+      file_name(name, n);
+      if(cfs_remove(name) < 0) {
+        errors++;
+      }
+    }
+    for(n = 0; n < files; n++) {
+      file_name(name, n);
+      fd = cfs_open(name, CFS_READ);
+      if((fd >= 0) != (n & 1)) {
+        errors++;
+      }
+      cfs_close(fd);
+    }
+
+    printf("%3u files: reserve %6lu ns, open %6lu ns, open missing %6lu ns, "
+           "%u errors\n", files, ns(create_ticks, files),
+           ns(open_ticks, OPENS), ns(missing_ticks, OPENS), errors);
+  }
+
+  cfs_coffee_format();
+  errors = 0;
+  memset(buf, 0xaa, sizeof(buf));
+  if(cfs_coffee_reserve("log", LOG_SIZE) < 0) {
+    errors++;
+  }
+  fd = cfs_open("log", CFS_WRITE | CFS_APPEND);
+  for(n = 0; n < LOG_DATA; n += sizeof(buf)) {
+    if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+      errors++;
+    }
+  }
+  cfs_close(fd);
+
+  log_ticks = 0;
+  for(n = 0; n < REOPENS; n++) {
+    reboot();
+    start = RTIMER_NOW();
+    fd = cfs_open("log", CFS_READ);
+    if(cfs_seek(fd, 0, CFS_SEEK_END) != LOG_DATA) {
+      errors++;
+    }
+    cfs_close(fd);
+    log_ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+  }
+  printf("%lu KB log with %u bytes: open after a reboot %lu ns, %u errors\n",
+         LOG_SIZE / 1024, LOG_DATA,
+         (unsigned long)(log_ticks * 1000000000 / RTIMER_SECOND / REOPENS),
+         errors);
+
+  /* Write a file to read, through a file descriptor kept open for
+     the coherence check below. */
+  cfs_coffee_format();
+  errors = 0;
+  if(cfs_coffee_reserve("data", READ_FILE_SIZE) < 0) {
+    errors++;
+  }
+  wfd = cfs_open("data", CFS_WRITE);
+  for(n = 0; n < READ_FILE_SIZE; n += sizeof(buf)) {
+    for(i = 0; i < sizeof(buf); i++) {
+      buf[i] = pattern(n + i);
+    }
+    if(cfs_write(wfd, buf, sizeof(buf)) != sizeof(buf)) {
+      errors++;
+    }
+  }
+  fd = cfs_open("data", CFS_READ);
+
+  log_ticks = 0;
+  for(i = 0; i < READ_PASSES; i++) {
+    start = RTIMER_NOW();
+    for(n = 0; n < READ_FILE_SIZE; n += READ_SIZE) {
+      errors += read_at(fd, n);
+    }
+    log_ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+  }
+  print_reads("Sequential", log_ticks, errors);
+
+  errors = 0;
+  log_ticks = 0;
+  for(i = 0; i < READ_PASSES; i++) {
+    start = RTIMER_NOW();
+    for(n = 0; n < READ_FILE_SIZE; n += READ_SIZE) {
+      errors += read_at(fd, random_rand() % (READ_FILE_SIZE - READ_SIZE));
+    }
+    log_ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+  }
+  print_reads("Random", log_ticks, errors);
+
+  /* Data that has been read must be read again after it is overwritten. */
+  errors = read_at(fd, 1000);
+  memset(buf, 0, sizeof(buf));
+  cfs_seek(wfd, 1000, CFS_SEEK_SET);
+  cfs_write(wfd, buf, READ_SIZE);
+  cfs_seek(fd, 1000, CFS_SEEK_SET);
+  if(cfs_read(fd, buf, 1) != 1 || buf[0] != 0) {
+    errors++;
+  }
+  cfs_close(fd);
+  cfs_close(wfd);
+  printf("Reads after a write: %u errors\n", errors);
+
+  /* Only the variables above are static, as the loop below lets the
+     background garbage collection run between the files. */
+  cfs_coffee_format();
+  cfs_coffee_get_gc_stats(&gc_start);
+  memset(buf, 0x55, sizeof(buf));
+  for(rotation = 0; rotation < ROTATIONS; rotation++) {
+    if(rotation >= ROTATE_LIVE) {
+      file_name(name, rotation - ROTATE_LIVE);
+      if(cfs_remove(name) < 0) {
+        rotate_errors++;
+      }
+    }
+
+    file_name(name, rotation);
+    start = RTIMER_NOW();
+    fd = cfs_open(name, CFS_WRITE);
+    for(n = 0; n < ROTATE_SIZE; n += sizeof(buf)) {
+      write_start = RTIMER_NOW();
+      if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+        rotate_errors++;
+      }
+      ticks = RTIMER_NOW() - write_start;
+      if(ticks > worst_write) {
+        worst_write = ticks;
+      }
+    }
+    cfs_close(fd);
+    ticks = RTIMER_NOW() - start;
+    if(ticks > worst_file) {
+      worst_file = ticks;
+    }
+    file_ticks += ticks;
+
+    PROCESS_PAUSE();
+  }
+  cfs_coffee_get_gc_stats(&gc_end);
+  printf("Rotated files: worst write %lu us, worst file %lu us, "
+         "%lu us per file, %u errors\n",
+         ns(worst_write, 1000), ns(worst_file, 1000),
+         (unsigned long)(file_ticks * 1000000 / RTIMER_SECOND / ROTATIONS),
+         rotate_errors);
+  printf("GC: %lu foreground runs erasing %lu sectors, %lu background runs "
+         "erasing %lu sectors\n",
+         gc_end.foreground_runs - gc_start.foreground_runs,
+         gc_end.foreground_sectors - gc_start.foreground_sectors,
+         gc_end.background_runs - gc_start.background_runs,
+         gc_end.background_sectors - gc_start.background_sectors);
+
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Power-loss test for Coffee on the native xmem emulation. The
+ *         system going down is simulated by clearing the RAM state of
+ *         Coffee while the storage keeps its contents. After every
+ *         such reboot, the files must have the ends and contents of
+ *         everything written to them, whether they were closed or not.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FAIL(x)   error = (x); goto end;
+
+/* Sessions of appends, enough to use up the end-of-file records */
+#define SESSIONS  20
+/*---------------------------------------------------------------------------*/
+static void
+reboot(void)
+{
+  unsigned size;
+  void *mem;
+
+  mem = cfs_coffee_get_protected_mem(&size);
+  memset(mem, 0, size);
+}
+/*---------------------------------------------------------------------------*/
+/* The byte at each offset is non-zero, so that scans find the end. */
+static unsigned char
+pattern(cfs_offset_t offset)
+{
+  return offset % 251 + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Appends len bytes and returns the descriptor, which is left open. */
+static int
+append(const char *name, unsigned len)
+{
+  unsigned char buf[64];
+  cfs_offset_t offset;
+  unsigned n, i;
+  int fd;
+
+  fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return -1;
+  }
+  offset = cfs_seek(fd, 0, CFS_SEEK_END);
+  while(len > 0) {
+    n = len < sizeof(buf) ? len : sizeof(buf);
+    for(i = 0; i < n; i++) {
+      buf[i] = pattern(offset + i);
+    }
+    if(cfs_write(fd, buf, n) != n) {
+      cfs_close(fd);
+      return -1;
+    }
+    offset += n;
+    len -= n;
+  }
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(const char *name, cfs_offset_t expected_end)
+{
+  unsigned char buf[64];
+  cfs_offset_t offset;
+  int fd, r, i;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  if(cfs_seek(fd, 0, CFS_SEEK_END) != expected_end) {
+    printf("%s ends at %ld, not %ld\n", name,
+           (long)cfs_seek(fd, 0, CFS_SEEK_END), (long)expected_end);
+    cfs_close(fd);
+    return 0;
+  }
+  cfs_seek(fd, 0, CFS_SEEK_SET);
+  for(offset = 0; (r = cfs_read(fd, buf, sizeof(buf))) > 0; offset += r) {
+    for(i = 0; i < r; i++) {
+      if(buf[i] != pattern(offset + i)) {
+        cfs_close(fd);
+        return 0;
+      }
+    }
+  }
+  cfs_close(fd);
+  return offset == expected_end;
+}
+/*---------------------------------------------------------------------------*/
+static int
+coffee_test_power_loss(void)
+{
+  int error;
+  int fd;
+  int i;
+  cfs_offset_t end;
+
+  cfs_coffee_format();
+
+  /* Test 1: An empty file. */
+  fd = cfs_open("empty", CFS_WRITE);
+  if(fd < 0) {
+    FAIL(1);
+  }
+  cfs_close(fd);
+  reboot();
+  if(!check("empty", 0)) {
+    FAIL(1);
+  }
+
+  /* Test 2: A closed file. */
+  fd = append("log", 1000);
+  if(fd < 0) {
+    FAIL(2);
+  }
+  cfs_close(fd);
+  reboot();
+  if(!check("log", 1000)) {
+    FAIL(2);
+  }
+
+  /* Test 3: Going down while the file is open for writing. */
+  if(append("log", 500) < 0) {
+    FAIL(3);
+  }
+  reboot();
+  if(!check("log", 1500)) {
+    FAIL(3);
+  }
+
+  /* Test 4: The end found after the previous reboot is kept. */
+  reboot();
+  if(!check("log", 1500)) {
+    FAIL(4);
+  }
+
+  /* Test 5: Going down after a closed and an open session. */
+  fd = append("log", 100);
+  if(fd < 0) {
+    FAIL(5);
+  }
+  cfs_close(fd);
+  if(append("log", 100) < 0) {
+    FAIL(5);
+  }
+  reboot();
+  if(!check("log", 1700)) {
+    FAIL(5);
+  }
+
+  /* Test 6: More sessions than there are end-of-file records. */
+  end = 1700;
+  for(i = 0; i < SESSIONS; i++) {
+    fd = append("log", 10);
+    if(fd < 0) {
+      FAIL(6);
+    }
+    end += 10;
+    if(i & 1) {
+      cfs_close(fd);
+    }
+    reboot();
+    if(!check("log", end)) {
+      FAIL(6);
+    }
+  }
+
+  /* Test 7: Going down after the file was extended beyond its
+     reserved size, which moves it. */
+  if(cfs_coffee_reserve("big", 200) < 0) {
+    FAIL(7);
+  }
+  if(append("big", 3000) < 0) {
+    FAIL(7);
+  }
+  reboot();
+  if(!check("big", 3000)) {
+    FAIL(7);
+  }
+  fd = append("big", 3000);
+  if(fd < 0) {
+    FAIL(7);
+  }
+  cfs_close(fd);
+  reboot();
+  if(!check("big", 6000) || !check("log", end) || !check("empty", 0)) {
+    FAIL(7);
+  }
+
+  error = 0;
+end:
+  return error;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(test_coffee_power_loss_process, "Coffee power-loss test");
+AUTOSTART_PROCESSES(&test_coffee_power_loss_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_coffee_power_loss_process, ev, data)
+{
+  int result;
+
+  PROCESS_BEGIN();
+
+  printf("Coffee power-loss test: COFFEE_EOF_RECORDS %d\n",
+         COFFEE_EOF_RECORDS);
+  result = coffee_test_power_loss();
+  if(result == 0) {
+    printf("Power loss: OK\n");
+  } else {
+    printf("Power loss: ERROR (test %d)\n", result);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of 6lowpan header compression: replays a trace of
+ *         the frames a router exchanges with its neighbors, times
+ *         sicslowpan uncompressing every frame and compressing again
+ *         the ones the router sent, and checks that both directions
+ *         reproduce the trace.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/rime/rime.h"
+#include "dev/radio.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Number of times the trace is replayed */
+#ifndef ROUNDS
+#define ROUNDS 20000
+#endif
+
+/* The nodes in the trace: this router, five neighbors and the
+   broadcast address. The neighbors have link-layer addresses
+   00:12:74:00:00:00:00:0n, where n is one more than their number. */
+#define THIS_NODE 0
+#define NUM_NEIGHBORS 5
+#define BROADCAST 6
+
+/* A 6lowpan frame of the trace, without its MAC header */
+struct trace_frame {
+  uint8_t sender;
+  uint8_t receiver;
+  uint8_t len;
+  uint8_t data[56];
+};
+
+/* The frames come from a network using the aaaa::/64 prefix,
+   which is the native platform's context 0. */
+static const struct trace_frame frames[] = {
+  /* CoAP request to N1 */
+  { 0, 1, 22,
+    {
+      0x7e, 0xf7, 0x00, 0xf0, 0x16, 0x33, 0x16, 0x33, 0x42, 0x49,
+      0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f,
+      0x96, 0x9d } },
+  /* CoAP response from N1 */
+  { 1, 0, 30,
+    {
+      0x7e, 0xf7, 0x00, 0xf0, 0x16, 0x33, 0x16, 0x33, 0x43, 0x4a,
+      0x51, 0x58, 0x5f, 0x66, 0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90,
+      0x97, 0x9e, 0xa5, 0xac, 0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6 } },
+  /* CoAP request from N3, forwarded to N2 */
+  { 0, 2, 31,
+    {
+      0x7c, 0xd7, 0x00, 0x3f, 0x02, 0x12, 0x74, 0x00, 0x00, 0x00,
+      0x00, 0x04, 0xf0, 0x16, 0x33, 0x16, 0x33, 0x44, 0x4b, 0x52,
+      0x59, 0x60, 0x67, 0x6e, 0x75, 0x7c, 0x83, 0x8a, 0x91, 0x98,
+      0x9f } },
+  /* CoAP response from N4, forwarded to a host outside the network */
+  { 2, 0, 55,
+    {
+      0x7c, 0xd0, 0x00, 0x3f, 0x02, 0x12, 0x74, 0x00, 0x00, 0x00,
+      0x00, 0x05, 0xbb, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0xf0, 0x16,
+      0x33, 0x16, 0x33, 0x45, 0x4c, 0x53, 0x5a, 0x61, 0x68, 0x6f,
+      0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5,
+      0xbc, 0xc3, 0xca, 0xd1, 0xd8 } },
+  /* Echo request from outside, forwarded to N3 through N1 */
+  { 0, 1, 49,
+    {
+      0x78, 0x85, 0x00, 0x3a, 0x3e, 0xbb, 0xbb, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+      0x00, 0x02, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x04, 0x80,
+      0x00, 0x2a, 0x31, 0x38, 0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62,
+      0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c, 0x93, 0x9a, 0xa1 } },
+  /* DIO */
+  { 0, 6, 32,
+    {
+      0x7b, 0x3b, 0x3a, 0x1a, 0x9b, 0x01, 0x2b, 0x32, 0x39, 0x40,
+      0x47, 0x4e, 0x55, 0x5c, 0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86,
+      0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe, 0xc5, 0xcc,
+      0xd3, 0xda } },
+  /* DIO from N3 */
+  { 3, 6, 32,
+    {
+      0x7b, 0x3b, 0x3a, 0x1a, 0x9b, 0x01, 0x2c, 0x33, 0x3a, 0x41,
+      0x48, 0x4f, 0x56, 0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87,
+      0x8e, 0x95, 0x9c, 0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6, 0xcd,
+      0xd4, 0xdb } },
+  /* DAO from N4 */
+  { 4, 0, 31,
+    {
+      0x7a, 0x33, 0x3a, 0x9b, 0x02, 0x2d, 0x34, 0x3b, 0x42, 0x49,
+      0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f,
+      0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5,
+      0xdc } },
+  /* DAO-ACK to N4 */
+  { 0, 4, 11,
+    {
+      0x7a, 0x33, 0x3a, 0x9b, 0x03, 0x2e, 0x35, 0x3c, 0x43, 0x4a,
+      0x51 } },
+  /* UDP to N5, compressed ports, ECN set */
+  { 0, 5, 16,
+    {
+      0x76, 0xf7, 0x00, 0x40, 0xf3, 0x12, 0x4b, 0x52, 0x59, 0x60,
+      0x67, 0x6e, 0x75, 0x7c, 0x83, 0x8a } },
+  /* UDP from N5, compressed ports, flow label set */
+  { 5, 0, 18,
+    {
+      0x6e, 0xf7, 0x00, 0x01, 0x23, 0x45, 0xf3, 0x21, 0x4c, 0x53,
+      0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b } },
+  /* TCP to a proxied address, 16-bit IID */
+  { 0, 2, 46,
+    {
+      0x7a, 0xf6, 0x00, 0x06, 0x00, 0x99, 0x23, 0x2a, 0x31, 0x38,
+      0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e,
+      0x85, 0x8c, 0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4,
+      0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee, 0xf5, 0xfc, 0x03, 0x0a,
+      0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34 } },
+  /* DAD neighbor solicitation from N1 */
+  { 1, 6, 37,
+    {
+      0x7b, 0x49, 0x3a, 0x02, 0x01, 0xff, 0x00, 0x00, 0x02, 0x87,
+      0x00, 0x32, 0x39, 0x40, 0x47, 0x4e, 0x55, 0x5c, 0x63, 0x6a,
+      0x71, 0x78, 0x7f, 0x86, 0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0,
+      0xb7, 0xbe, 0xc5, 0xcc, 0xd3, 0xda, 0xe1 } },
+};
+#define NUM_FRAMES (sizeof(frames) / sizeof(frames[0]))
+
+/* The order the frames appear in the trace */
+static const uint8_t trace[] = {
+  5, 6, 0, 1, 0, 1, 2, 3, 7, 8, 0, 1, 9, 10, 4, 2, 3, 0, 1, 11,
+  12, 6, 0, 1, 2, 3, 9, 10, 7, 8, 0, 1, 4, 2, 3, 11, 0, 1, 2, 3
+};
+#define TRACE_LEN (sizeof(trace) / sizeof(trace[0]))
+
+/* The IPv6 packets uncompressed from the frames during the first
+   replay, which the later ones are checked against. */
+static uint8_t packets[NUM_FRAMES][UIP_BUFSIZE - UIP_LLH_LEN];
+static uint16_t packet_lens[NUM_FRAMES];
+
+static const struct trace_frame *current;
+static int recording;
+static unsigned long errors;
+
+/* The last frame sent by the radio */
+static uint8_t sent_frame[PACKETBUF_SIZE];
+static uint16_t sent_len;
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  /* The frame is still in packetbuf, after its MAC header. */
+  sent_len = payload_len - packetbuf_hdrlen();
+  memcpy(sent_frame, (const uint8_t *)payload + packetbuf_hdrlen(), sent_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send(const void *payload, unsigned short payload_len)
+{
+  prepare(payload, payload_len);
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+/* Called by sicslowpan with the uncompressed packet in uip_buf */
+static void
+input_callback(void)
+{
+  int i = current - frames;
+
+  if(recording) {
+    memcpy(packets[i], UIP_IP_BUF, uip_len);
+    packet_lens[i] = uip_len;
+  } else if(uip_len != packet_lens[i] ||
+            memcmp(packets[i], UIP_IP_BUF, uip_len) != 0) {
+    errors++;
+  }
+  /* Keep uIP from processing the packet */
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+output_callback(int mac_status)
+{
+}
+/*---------------------------------------------------------------------------*/
+RIME_SNIFFER(sniffer, input_callback, output_callback);
+/*---------------------------------------------------------------------------*/
+static void
+node_lladdr(uint8_t node, uip_lladdr_t *lladdr)
+{
+  if(node == THIS_NODE) {
+    memcpy(lladdr, &uip_lladdr, sizeof(uip_lladdr_t));
+  } else if(node == BROADCAST) {
+    memset(lladdr, 0, sizeof(uip_lladdr_t));
+  } else {
+    memset(lladdr, 0, sizeof(uip_lladdr_t));
+    lladdr->addr[0] = 0x00;
+    lladdr->addr[1] = 0x12;
+    lladdr->addr[2] = 0x74;
+    lladdr->addr[sizeof(uip_lladdr_t) - 1] = node + 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+uncompress(const struct trace_frame *f)
+{
+  uip_lladdr_t lladdr;
+
+  current = f;
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), f->data, f->len);
+  packetbuf_set_datalen(f->len);
+  node_lladdr(f->sender, &lladdr);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (linkaddr_t *)&lladdr);
+  node_lladdr(f->receiver, &lladdr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, (linkaddr_t *)&lladdr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(compression_benchmark_process, "Header compression benchmark");
+AUTOSTART_PROCESSES(&compression_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(compression_benchmark_process, ev, data)
+{
+  unsigned long n;
+  unsigned long long ticks;
+  unsigned long frames_in, frames_out;
+  rtimer_clock_t start;
+  const struct trace_frame *f;
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  printf("compression benchmark: SICSLOWPAN_CONF_COMPRESSION_CACHE %d, "
+         "%u frames in the trace, %d rounds\n",
+         SICSLOWPAN_CONF_COMPRESSION_CACHE, (unsigned)TRACE_LEN, ROUNDS);
+
+  /* The neighbors are known to ND, as they would be after exchanging
+     the trace's first packets. */
+  for(i = 1; i <= NUM_NEIGHBORS; i++) {
+    node_lladdr(i, &lladdr);
+    uip_create_linklocal_prefix(&ipaddr);
+    uip_ds6_set_addr_iid(&ipaddr, &lladdr);
+    uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE);
+  }
+  rime_sniffer_add(&sniffer);
+
+  /* Record the uncompressed packets */
+  recording = 1;
+  for(i = 0; i < NUM_FRAMES; i++) {
+    uncompress(&frames[i]);
+  }
+  recording = 0;
+
+  /* The calls are too short for the rtimer, so whole replays are
+     timed, including setting packetbuf up. */
+  errors = 0;
+  frames_in = 0;
+  start = RTIMER_NOW();
+  for(n = 0; n < ROUNDS; n++) {
+    for(i = 0; i < TRACE_LEN; i++) {
+      uncompress(&frames[trace[i]]);
+      frames_in++;
+    }
+  }
+  ticks = (rtimer_clock_t)(RTIMER_NOW() - start);
+  printf("uncompress: %lu frames, %lu ns per frame, %lu errors\n",
+         frames_in,
+         (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / frames_in),
+         errors);
+
+  /* Compress the packets this node sent, which must give the frames
+     of the trace back */
+  errors = 0;
+  frames_out = 0;
+  start = RTIMER_NOW();
+  for(n = 0; n < ROUNDS; n++) {
+    for(i = 0; i < TRACE_LEN; i++) {
+      f = &frames[trace[i]];
+      if(f->sender != THIS_NODE) {
+        continue;
+      }
+      memcpy(UIP_IP_BUF, packets[trace[i]], packet_lens[trace[i]]);
+      uip_len = packet_lens[trace[i]];
+      node_lladdr(f->receiver, &lladdr);
+      sent_len = 0;
+      tcpip_output(f->receiver == BROADCAST ? NULL : &lladdr);
+      frames_out++;
+      if(sent_len != f->len || memcmp(sent_frame, f->data, f->len) != 0) {
+        errors++;
+      }
+    }
+  }
+  ticks = (rtimer_clock_t)(RTIMER_NOW() - start);
+  printf("compress:   %lu frames, %lu ns per frame, %lu errors\n",
+         frames_out,
+         (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / frames_out),
+         errors);
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
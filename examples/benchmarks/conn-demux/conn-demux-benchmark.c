@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of uIP input demultiplexing: measures the time
+ *         uip_input() takes to deliver a UDP datagram or a TCP segment
+ *         to its connection with 10, 100 and 500 connections open.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_TCP_BUF ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+
+#define UDP_PAYLOAD_LEN 8
+#define TCP_LISTEN_PORT 80
+#define TCP_REMOTE_PORT 10000
+
+/* Number of packets timed for each measurement */
+#define OPERATIONS 100000
+
+static const int sizes[] = { 10, 100, 500 };
+static uip_ipaddr_t remote;
+static struct uip_udp_conn *udp_conns[UIP_UDP_CONNS];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t start, unsigned long ops)
+{
+  return (unsigned long)(clock_time() - start) * 1000000UL / ops;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ip_header(uint8_t proto, uint16_t payload_len)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = payload_len >> 8;
+  UIP_IP_BUF->len[1] = payload_len & 0xff;
+  UIP_IP_BUF->proto = proto;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &remote);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  uip_len = UIP_IPH_LEN + payload_len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_input(uint16_t destport)
+{
+  ip_header(UIP_PROTO_UDP, UIP_UDPH_LEN + UDP_PAYLOAD_LEN);
+  UIP_UDP_BUF->srcport = UIP_HTONS(TCP_REMOTE_PORT);
+  UIP_UDP_BUF->destport = destport;
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + UDP_PAYLOAD_LEN);
+  UIP_UDP_BUF->udpchksum = 0;
+  memset(UIP_UDP_BUF + 1, 0, UDP_PAYLOAD_LEN);
+  UIP_UDP_BUF->udpchksum = ~uip_udpchksum();
+
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_input(uint16_t srcport, uint8_t flags)
+{
+  ip_header(UIP_PROTO_TCP, UIP_TCPH_LEN);
+  memset(UIP_TCP_BUF, 0, UIP_TCPH_LEN);
+  UIP_TCP_BUF->srcport = uip_htons(srcport);
+  UIP_TCP_BUF->destport = UIP_HTONS(TCP_LISTEN_PORT);
+  /* The SYN has sequence number 0; later segments follow it. */
+  if(!(flags & TCP_SYN)) {
+    UIP_TCP_BUF->seqno[3] = 1;
+  }
+  UIP_TCP_BUF->tcpoffset = 5 << 4;
+  UIP_TCP_BUF->flags = flags;
+  UIP_TCP_BUF->wnd[0] = 1;
+  UIP_TCP_BUF->tcpchksum = ~uip_tcpchksum();
+
+  uip_input();
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_udp(int n)
+{
+  clock_time_t start;
+  uip_stats_t dropped;
+  int i;
+
+  for(i = 0; i < n; i++) {
+    udp_conns[i] = uip_udp_new(NULL, 0);
+    udp_conns[i]->appstate.p = NULL;
+    udp_conns[i]->appstate.state = NULL;
+  }
+
+  dropped = uip_stat.udp.drop;
+  start = clock_time();
+  for(i = 0; i < OPERATIONS; i++) {
+    udp_input(udp_conns[i % n]->lport);
+  }
+  printf("%3d UDP connections: %lu ns per datagram (%u dropped)\n",
+         n, ns_per_op(start, OPERATIONS),
+         (unsigned)(uip_stats_t)(uip_stat.udp.drop - dropped));
+
+  for(i = 0; i < n; i++) {
+    uip_udp_remove(udp_conns[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_tcp(int n)
+{
+  clock_time_t start;
+  int i, open;
+
+  /* Open the connections passively: each SYN leaves one in SYN_RCVD,
+     where a bare ACK that does not acknowledge our SYN is dropped
+     without changing its state. */
+  for(i = 0; i < n; i++) {
+    tcp_input(TCP_REMOTE_PORT + i, TCP_SYN);
+  }
+
+  start = clock_time();
+  for(i = 0; i < OPERATIONS; i++) {
+    tcp_input(TCP_REMOTE_PORT + i % n, TCP_ACK);
+  }
+
+  open = 0;
+  for(i = 0; i < UIP_CONNS; i++) {
+    if(uip_conns[i].tcpstateflags == UIP_SYN_RCVD) {
+      open++;
+    }
+    uip_conns[i].tcpstateflags = UIP_CLOSED;
+  }
+  printf("%3d TCP connections: %lu ns per segment (%d still open)\n",
+         n, ns_per_op(start, OPERATIONS), open);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(conn_demux_benchmark_process, "Connection demultiplexing benchmark");
+AUTOSTART_PROCESSES(&conn_demux_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(conn_demux_benchmark_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process initialize the IPv6 stack. */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("conn demux benchmark: %s\n",
+         UIP_CONN_HASH ? "connection hash" : "linear scan");
+
+  uip_ip6addr(&remote, 0xfe80, 0, 0, 0, 0x0212, 0x7400, 0, 2);
+  uip_listen(UIP_HTONS(TCP_LISTEN_PORT));
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run_udp(sizes[i]);
+  }
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run_tcp(sizes[i]);
+  }
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
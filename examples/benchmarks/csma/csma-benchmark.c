@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the CSMA packet queues: a node sends the same
+ *         load to many neighbors, a few of which are behind lossy
+ *         links, and prints how many packets each kind of neighbor
+ *         received and the time spent queueing a packet.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/mac/csma.h"
+#include "dev/radio.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef NEIGHBORS
+#define NEIGHBORS 32
+#endif
+
+/* The first LOSSY neighbors lose LOSS_PERCENT of their frames */
+#ifndef LOSSY
+#define LOSSY 4
+#endif
+#ifndef LOSS_PERCENT
+#define LOSS_PERCENT 80
+#endif
+
+/* One packet is sent to every neighbor each round */
+#ifndef ROUNDS
+#define ROUNDS 200
+#endif
+#define ROUND_INTERVAL (CLOCK_SECOND / 50)
+
+#define PAYLOAD_LEN 60
+
+struct neighbor {
+  unsigned long sent, delivered, failed, frames;
+};
+
+static struct neighbor neighbors[NEIGHBORS];
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(linkaddr_t *addr, int i)
+{
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 2] = (i + 2) >> 8;
+  addr->u8[LINKADDR_SIZE - 1] = (i + 2) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiver(void)
+{
+  const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+  return ((addr->u8[LINKADDR_SIZE - 2] << 8) | addr->u8[LINKADDR_SIZE - 1]) - 2;
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  int i;
+
+  i = receiver();
+  if(i < 0 || i >= NEIGHBORS) {
+    return RADIO_TX_OK;
+  }
+  neighbors[i].frames++;
+  if(i < LOSSY && random_rand() % 100 < LOSS_PERCENT) {
+    return RADIO_TX_NOACK;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send(const void *payload, unsigned short payload_len)
+{
+  prepare(payload, payload_len);
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver lossy_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  struct neighbor *n = ptr;
+
+  if(status == MAC_TX_OK) {
+    n->delivered++;
+  } else {
+    n->failed++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_neighbors(const char *name, int first, int last)
+{
+  unsigned long sent, delivered, frames;
+  int i;
+
+  sent = delivered = frames = 0;
+  for(i = first; i < last; i++) {
+    sent += neighbors[i].sent;
+    delivered += neighbors[i].delivered;
+    frames += neighbors[i].frames;
+  }
+  printf("%s: %d neighbors, %lu packets, %lu delivered (%lu%%), %lu frames\n",
+         name, last - first, sent, delivered,
+         sent > 0 ? delivered * 100 / sent : 0, frames);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(csma_benchmark_process, "CSMA benchmark");
+AUTOSTART_PROCESSES(&csma_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(csma_benchmark_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long round, ticks;
+  static rtimer_clock_t start;
+  static uint8_t payload[PAYLOAD_LEN];
+  static int i;
+  linkaddr_t addr;
+
+  PROCESS_BEGIN();
+
+  printf("csma benchmark: CSMA_FAIR %d, %d neighbors, %d lossy at %d%%, "
+         "%d queuebufs\n", CSMA_FAIR, NEIGHBORS, LOSSY, LOSS_PERCENT,
+         QUEUEBUF_NUM);
+
+  random_init(0);
+  ticks = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    for(i = 0; i < NEIGHBORS; i++) {
+      packetbuf_clear();
+      packetbuf_copyfrom(payload, sizeof(payload));
+      make_addr(&addr, i);
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+      packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+      neighbors[i].sent++;
+      start = RTIMER_NOW();
+      NETSTACK_MAC.send(packet_sent, &neighbors[i]);
+      ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+      /* Packets arrive one at a time, as when forwarding */
+      PROCESS_PAUSE();
+    }
+    etimer_set(&et, ROUND_INTERVAL);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  /* Let the lossy links drain */
+  for(i = 0; i < 5 * CLOCK_SECOND / ROUND_INTERVAL &&
+        queuebuf_numfree() < QUEUEBUF_NUM; i++) {
+    etimer_set(&et, ROUND_INTERVAL);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  print_neighbors("good links ", LOSSY, NEIGHBORS);
+  print_neighbors("lossy links", 0, LOSSY);
+  printf("%lu ns per queued packet\n",
+         (unsigned long)((unsigned long long)ticks * 1000000000 / RTIMER_SECOND /
+                         (ROUNDS * NEIGHBORS)));
+#if CSMA_FAIR
+  printf("queued %lu, pushed out %lu, dropped %lu full, %lu no buffer, "
+         "longest queue %u\n",
+         csma_stats.queued, csma_stats.pushed_out, csma_stats.dropped_full,
+         csma_stats.dropped_nobuf, csma_stats.max_queue_len);
+#endif /* CSMA_FAIR */
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the IPv6 routing table: measures the cost of
+ *         adding, looking up and removing host routes with 100, 1000
+ *         and 10000 routes in the table.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_NEXTHOPS 8
+#define NUM_PREFIXES 4
+
+/* Number of operations timed for each measurement */
+#define OPERATIONS 10000
+
+static const int sizes[] = { 100, 1000, 10000 };
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *addr, int i)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0212, 0x7400, i >> 16, i & 0xffff);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns_per_op(clock_time_t start, unsigned long ops)
+{
+  return (unsigned long)(clock_time() - start) * 1000000UL / ops;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_routes(int n)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  for(i = 0; i < n; i++) {
+    host_addr(&addr, i);
+    uip_ds6_route_add(&addr, 128, &nexthops[i % NUM_NEXTHOPS]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_routes(int n)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  for(i = 0; i < n; i++) {
+    host_addr(&addr, i);
+    uip_ds6_route_rm(uip_ds6_route_lookup(&addr));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(int n)
+{
+  clock_time_t start;
+  unsigned long add, lookup, rm;
+  uip_ipaddr_t addr;
+  int i, rounds, misses;
+
+  rounds = OPERATIONS / n;
+
+  /* Add and remove all routes, measuring each separately. */
+  add = rm = 0;
+  for(i = 0; i < rounds; i++) {
+    start = clock_time();
+    add_routes(n);
+    add += clock_time() - start;
+    start = clock_time();
+    remove_routes(n);
+    rm += clock_time() - start;
+  }
+
+  add_routes(n);
+  misses = 0;
+  start = clock_time();
+  for(i = 0; i < OPERATIONS; i++) {
+    host_addr(&addr, random_rand() % n);
+    if(uip_ds6_route_lookup(&addr) == NULL) {
+      misses++;
+    }
+  }
+  lookup = ns_per_op(start, OPERATIONS);
+  remove_routes(n);
+
+  printf("%5d routes: add %lu ns, lookup %lu ns, remove %lu ns (%d misses)\n",
+         n, add * 1000000UL / (rounds * n), lookup, rm * 1000000UL / (rounds * n),
+         misses);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ds6_route_benchmark_process, "Routing table benchmark");
+AUTOSTART_PROCESSES(&ds6_route_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_route_benchmark_process, ev, data)
+{
+  static struct etimer et;
+  uip_lladdr_t lladdr;
+  uip_ipaddr_t prefix;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process initialize the IPv6 stack. */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("ds6 route benchmark: %s\n",
+         UIP_DS6_ROUTE_HASH ? "host route hash" : "route list");
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0x0212, 0x7400, 0, i + 1);
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE);
+  }
+
+  /* A few prefix routes, as found on a border router. */
+  for(i = 0; i < NUM_PREFIXES; i++) {
+    uip_ip6addr(&prefix, 0xfd01 + i, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_route_add(&prefix, 64, &nexthops[i]);
+  }
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the event timer library: sets, resets, stops
+ *         and expires a large number of event timers and reports the
+ *         time spent in each phase.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+
+#ifndef NUM_TIMERS
+#define NUM_TIMERS 10000
+#endif
+
+/* All timers expire within this many ticks of each other, so that
+   large batches of timers fire together. */
+#define SPREAD 16
+
+static struct etimer timers[NUM_TIMERS];
+/*---------------------------------------------------------------------------*/
+PROCESS(etimer_benchmark_process, "Event timer benchmark");
+AUTOSTART_PROCESSES(&etimer_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_benchmark_process, ev, data)
+{
+  static clock_time_t start;
+  static unsigned long expired;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  printf("etimer benchmark: %u timers, %s\n", NUM_TIMERS,
+         ETIMER_HEAP ? "heap" : "list");
+
+  start = clock_time();
+  for(i = 0; i < NUM_TIMERS; i++) {
+    etimer_set(&timers[i], CLOCK_SECOND + (i % SPREAD));
+  }
+  printf("set:     %lu ms\n", (unsigned long)(clock_time() - start));
+
+  start = clock_time();
+  for(i = 0; i < NUM_TIMERS; i++) {
+    etimer_restart(&timers[i]);
+  }
+  printf("restart: %lu ms\n", (unsigned long)(clock_time() - start));
+
+  start = clock_time();
+  for(i = 0; i < NUM_TIMERS; i += 2) {
+    etimer_stop(&timers[i]);
+  }
+  printf("stop:    %lu ms\n", (unsigned long)(clock_time() - start));
+
+  /* Wait for the first expiration, then time how long it takes until
+     all remaining timers have been delivered. */
+  expired = 0;
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+  start = clock_time();
+  expired++;
+  while(expired < NUM_TIMERS / 2) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    expired++;
+  }
+  printf("expire:  %lu ms for %lu timers\n",
+         (unsigned long)(clock_time() - start), expired);
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    if(!etimer_expired(&timers[i])) {
+      printf("error: timer %d still pending\n", i);
+    }
+  }
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of 6lowpan fragmentation: sends datagrams of several
+ *         sizes through sicslowpan, CSMA and nullrdc, checks every
+ *         fragment that reaches the radio and reports the time spent
+ *         fragmenting and the memory held by the queued fragments.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcpip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "dev/radio.h"
+#include "sys/rtimer.h"
+#if QUEUEBUF_MMEM
+#include "lib/mmem.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+/* Number of datagrams sent for each size */
+#ifndef ROUNDS
+#define ROUNDS 10000
+#endif
+
+static const uint16_t sizes[] = { 200, 640, UIP_BUFSIZE - UIP_LLH_LEN };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static const uip_lladdr_t dest = {{ 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x02 }};
+
+/* The datagram being sent. uip_buf cannot be used to check the
+   fragments as the stack may send other packets meanwhile. */
+static uint8_t datagram[UIP_BUFSIZE];
+static uint16_t datagram_len;
+
+/* Fragment checks, updated by the radio driver */
+static unsigned long frames, complete, errors;
+static uint16_t next_offset;
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  const uint8_t *frag;
+  uint16_t len, offset;
+
+  /* The frame is still in packetbuf, after its MAC header. */
+  frag = (const uint8_t *)payload + packetbuf_hdrlen();
+  len = payload_len - packetbuf_hdrlen();
+
+  if((frag[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAG1) {
+    frames++;
+    next_offset = 0;
+    if(((frag[0] << 8 | frag[1]) & 0x7ff) != datagram_len) {
+      errors++;
+    }
+    return 1;
+  }
+  if((frag[0] & 0xf8) != SICSLOWPAN_DISPATCH_FRAGN) {
+    /* Not a fragment: neighbor discovery, for instance */
+    return 1;
+  }
+  frames++;
+
+  /* FRAGN: the payload must continue the datagram where the previous
+     fragment stopped. */
+  if(((frag[0] << 8 | frag[1]) & 0x7ff) != datagram_len) {
+    errors++;
+    return 1;
+  }
+  offset = frag[4];
+  frag += SICSLOWPAN_FRAGN_HDR_LEN;
+  len -= SICSLOWPAN_FRAGN_HDR_LEN;
+  if((next_offset != 0 && offset != next_offset) ||
+     offset * 8 + len > datagram_len ||
+     memcmp(frag, datagram + offset * 8, len) != 0) {
+    errors++;
+    return 1;
+  }
+  next_offset = offset + len / 8;
+  if(offset * 8 + len == datagram_len) {
+    complete++;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send(const void *payload, unsigned short payload_len)
+{
+  prepare(payload, payload_len);
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver capture_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_datagram(uint16_t len)
+{
+  uint16_t i;
+
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN + UIP_UDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (len - UIP_IPH_LEN) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_create_linklocal_prefix(&UIP_IP_BUF->srcipaddr);
+  uip_ds6_set_addr_iid(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  uip_create_linklocal_prefix(&UIP_IP_BUF->destipaddr);
+  uip_ds6_set_addr_iid(&UIP_IP_BUF->destipaddr, (uip_lladdr_t *)&dest);
+  UIP_UDP_BUF->srcport = UIP_HTONS(5678);
+  UIP_UDP_BUF->destport = UIP_HTONS(8765);
+  UIP_UDP_BUF->udplen = UIP_HTONS(len - UIP_IPH_LEN);
+  for(i = UIP_IPH_LEN + UIP_UDPH_LEN; i < len; i++) {
+    ((uint8_t *)UIP_IP_BUF)[i] = i * 7;
+  }
+  uip_len = len;
+  memcpy(datagram, UIP_IP_BUF, len);
+  datagram_len = len;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(fragment_benchmark_process, "Fragmentation benchmark");
+AUTOSTART_PROCESSES(&fragment_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(fragment_benchmark_process, ev, data)
+{
+  static unsigned s;
+  static unsigned long n, sent_frames;
+  static unsigned long long ticks;
+  static rtimer_clock_t start;
+#if QUEUEBUF_MMEM
+  static unsigned int peak;
+  struct mmem_stats stats;
+#endif /* QUEUEBUF_MMEM */
+
+  PROCESS_BEGIN();
+
+  printf("fragment benchmark: QUEUEBUF_MMEM %d, %d queuebufs, %d rounds\n",
+         QUEUEBUF_MMEM, QUEUEBUF_NUM, ROUNDS);
+#if QUEUEBUF_MMEM
+  printf("queuebuf data: up to %u bytes of managed memory\n",
+         (unsigned)MMEM_CONF_SIZE);
+#else /* QUEUEBUF_MMEM */
+  printf("queuebuf data: %u bytes reserved\n",
+         (unsigned)(QUEUEBUF_NUM * (PACKETBUF_SIZE + sizeof(uint16_t) +
+                                    PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) +
+                                    PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr))));
+#endif /* QUEUEBUF_MMEM */
+
+  for(s = 0; s < NUM_SIZES; s++) {
+    frames = complete = errors = 0;
+    ticks = 0;
+#if QUEUEBUF_MMEM
+    peak = 0;
+#endif /* QUEUEBUF_MMEM */
+    for(n = 0; n < ROUNDS; n++) {
+      make_datagram(sizes[s]);
+      start = RTIMER_NOW();
+      tcpip_output(&dest);
+      ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+      sent_frames = QUEUEBUF_NUM - queuebuf_numfree();
+#if QUEUEBUF_MMEM
+      mmem_get_stats(&stats);
+      if(MMEM_CONF_SIZE - stats.free > peak) {
+        peak = MMEM_CONF_SIZE - stats.free;
+      }
+#endif /* QUEUEBUF_MMEM */
+
+      /* Let CSMA send the fragments before the next datagram */
+      while(queuebuf_numfree() < QUEUEBUF_NUM) {
+        PROCESS_PAUSE();
+      }
+    }
+    printf("%4u bytes: %lu fragments, %lu ns per datagram, %lu frames, "
+           "%lu complete, %lu errors\n",
+           sizes[s], sent_frames,
+           (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / ROUNDS),
+           frames, complete, errors);
+#if QUEUEBUF_MMEM
+    printf("           %u bytes of queued fragments at most\n", peak);
+#endif /* QUEUEBUF_MMEM */
+  }
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of llsec with noncoresec: checks the AES-128 drivers
+ *         and CCM* against published test vectors, times the AES-128
+ *         drivers, and reports how many frames per second noncoresec
+ *         secures and verifies with the AES_128 driver configured.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "net/llsec/noncoresec/noncoresec.h"
+#include "net/mac/framer.h"
+#include "net/llsec/llsec802154.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "sys/rtimer.h"
+#include "aes-128-native.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The encryptions are too short for the rtimer, so they are timed in
+   batches of AES_BLOCKS. */
+#ifndef AES_BLOCKS
+#define AES_BLOCKS 100000
+#endif
+
+/* ROUNDS times, FRAMES frames with PAYLOAD_LEN bytes of payload are
+   secured, then verified. */
+#ifndef PAYLOAD_LEN
+#define PAYLOAD_LEN 80
+#endif
+#define FRAMES 100
+#define ROUNDS 200
+
+struct driver {
+  const char *name;
+  const struct aes_128_driver *driver;
+};
+
+static const struct driver drivers[] = {
+  { "aes_128_driver", &aes_128_driver },
+  { "aes_128_ttable_driver", &aes_128_ttable_driver },
+  { "native_aes_128_driver", &native_aes_128_driver }
+};
+#define NUM_DRIVERS (sizeof(drivers) / sizeof(drivers[0]))
+
+/* FIPS-197, appendix C.1 */
+static const uint8_t aes_key[AES_128_KEY_LENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t aes_plaintext[AES_128_BLOCK_SIZE] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t aes_ciphertext[AES_128_BLOCK_SIZE] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/* RFC 3610, packet vector #1 */
+static const uint8_t ccm_key[AES_128_KEY_LENGTH] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+static const uint8_t ccm_nonce[CCM_STAR_NONCE_LENGTH] = {
+  0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00,
+  0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5
+};
+#define CCM_A_LEN 8
+#define CCM_M_LEN 23
+#define CCM_MIC_LEN 8
+static const uint8_t ccm_packet[CCM_A_LEN + CCM_M_LEN + CCM_MIC_LEN] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+  0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+  0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84,
+  0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0
+};
+
+static const linkaddr_t sender = { { 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+static const linkaddr_t receiver = { { 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+
+static struct {
+  uint8_t len;
+  uint8_t data[PACKETBUF_SIZE];
+} frames[FRAMES];
+static uint8_t payload[PAYLOAD_LEN];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ns(unsigned long long ticks, unsigned long n)
+{
+  return (unsigned long)(ticks * 1000000000 / RTIMER_SECOND / n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark_aes(const struct driver *d)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  rtimer_clock_t start;
+  unsigned long n;
+
+  d->driver->set_key(aes_key);
+  memcpy(block, aes_plaintext, AES_128_BLOCK_SIZE);
+  d->driver->encrypt(block);
+  if(memcmp(block, aes_ciphertext, AES_128_BLOCK_SIZE) != 0) {
+    printf("%s: wrong ciphertext\n", d->name);
+    return;
+  }
+
+  start = RTIMER_NOW();
+  for(n = 0; n < AES_BLOCKS; n++) {
+    d->driver->encrypt(block);
+  }
+  printf("%-22s %4lu ns per block\n", d->name,
+         ns((rtimer_clock_t)(RTIMER_NOW() - start), AES_BLOCKS));
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_ccm(void)
+{
+  uint8_t buf[CCM_A_LEN + CCM_M_LEN + CCM_MIC_LEN];
+  uint8_t mic[CCM_MIC_LEN];
+  uint8_t i;
+
+  for(i = 0; i < CCM_A_LEN + CCM_M_LEN; i++) {
+    buf[i] = i;
+  }
+  CCM_STAR.set_key(ccm_key);
+  CCM_STAR.aead(ccm_nonce, buf + CCM_A_LEN, CCM_M_LEN, buf, CCM_A_LEN,
+                buf + CCM_A_LEN + CCM_M_LEN, CCM_MIC_LEN, 1);
+  if(memcmp(buf, ccm_packet, sizeof(buf)) != 0) {
+    printf("CCM*: wrong encryption\n");
+    return 0;
+  }
+  CCM_STAR.aead(ccm_nonce, buf + CCM_A_LEN, CCM_M_LEN, buf, CCM_A_LEN,
+                mic, CCM_MIC_LEN, 0);
+  for(i = 0; i < CCM_A_LEN + CCM_M_LEN; i++) {
+    if(buf[i] != i) {
+      printf("CCM*: wrong decryption\n");
+      return 0;
+    }
+  }
+  if(memcmp(mic, ccm_packet + CCM_A_LEN + CCM_M_LEN, CCM_MIC_LEN) != 0) {
+    printf("CCM*: wrong MIC on decryption\n");
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Secures frames[i] as sent from sender to receiver */
+static int
+create(int i)
+{
+  linkaddr_set_node_addr((linkaddr_t *)&sender);
+  packetbuf_clear();
+  packetbuf_copyfrom(payload, PAYLOAD_LEN);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+  if(noncoresec_framer.create() < 0) {
+    return 0;
+  }
+  frames[i].len = packetbuf_totlen();
+  memcpy(frames[i].data, packetbuf_hdrptr(), frames[i].len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Verifies frames[i] as received by receiver */
+static int
+parse(int i)
+{
+  linkaddr_set_node_addr((linkaddr_t *)&receiver);
+  packetbuf_clear();
+  packetbuf_copyfrom(frames[i].data, frames[i].len);
+  if(noncoresec_framer.parse() < 0) {
+    return 0;
+  }
+  return packetbuf_datalen() == PAYLOAD_LEN &&
+    memcmp(packetbuf_dataptr(), payload, PAYLOAD_LEN) == 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(llsec_benchmark_process, "llsec benchmark");
+AUTOSTART_PROCESSES(&llsec_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(llsec_benchmark_process, ev, data)
+{
+  unsigned long long create_ticks, parse_ticks;
+  unsigned long errors;
+  rtimer_clock_t start;
+  unsigned i, round;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_DRIVERS; i++) {
+    benchmark_aes(&drivers[i]);
+  }
+  if(!check_ccm()) {
+    PROCESS_EXIT();
+  }
+
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    payload[i] = i;
+  }
+  noncoresec_driver.init();
+
+  printf("noncoresec: security level %d, %d bytes of payload, %d frames\n",
+         LLSEC802154_SECURITY_LEVEL, PAYLOAD_LEN, FRAMES * ROUNDS);
+  create_ticks = parse_ticks = 0;
+  errors = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    start = RTIMER_NOW();
+    for(i = 0; i < FRAMES; i++) {
+      if(!create(i)) {
+        errors++;
+      }
+    }
+    create_ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+
+    start = RTIMER_NOW();
+    for(i = 0; i < FRAMES; i++) {
+      if(!parse(i)) {
+        errors++;
+      }
+    }
+    parse_ticks += (rtimer_clock_t)(RTIMER_NOW() - start);
+  }
+  printf("create: %lu ns per frame, %lu frames/s\n",
+         ns(create_ticks, FRAMES * ROUNDS),
+         (unsigned long)((unsigned long long)FRAMES * ROUNDS * RTIMER_SECOND / create_ticks));
+  printf("parse:  %lu ns per frame, %lu frames/s\n",
+         ns(parse_ticks, FRAMES * ROUNDS),
+         (unsigned long)((unsigned long long)FRAMES * ROUNDS * RTIMER_SECOND / parse_ticks));
+  printf("%lu errors\n", errors);
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
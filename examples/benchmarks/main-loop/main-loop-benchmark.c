@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the native main loop: measures the CPU time
+ *         used while idle, how late etimers fire and how long it
+ *         takes for data written to a pipe to be handled.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define IDLE_TIME    (5 * CLOCK_SECOND)
+#define TIMER_ROUNDS 200
+#define PIPE_ROUNDS  500
+
+static int pipefd[2] = { -1, -1 };
+static pid_t writer;
+static unsigned long pipe_count, pipe_total, pipe_max;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+cpu_us(void)
+{
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000UL +
+    ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(pipefd[0], rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  unsigned long sent, latency;
+
+  if(FD_ISSET(pipefd[0], rset) &&
+     read(pipefd[0], &sent, sizeof(sent)) == sizeof(sent)) {
+    latency = now_us() - sent;
+    pipe_total += latency;
+    if(latency > pipe_max) {
+      pipe_max = latency;
+    }
+    pipe_count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback pipe_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+/* Runs in a child process: writes a time stamp every few milliseconds. */
+static void
+write_stamps(void)
+{
+  unsigned long sent;
+  int i;
+
+  for(i = 0; i < PIPE_ROUNDS; i++) {
+    usleep(2000 + random_rand() % 8000);
+    sent = now_us();
+    if(write(pipefd[1], &sent, sizeof(sent)) != sizeof(sent)) {
+      break;
+    }
+  }
+  _exit(0);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(main_loop_benchmark_process, "Main loop benchmark");
+AUTOSTART_PROCESSES(&main_loop_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(main_loop_benchmark_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long start, cpu, late, total, max;
+  static clock_time_t interval;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  /* Let the output and the rest of the system settle. */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("main loop benchmark\n");
+
+  /* CPU time used while waiting for a single etimer */
+  cpu = cpu_us();
+  etimer_set(&et, IDLE_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  cpu = cpu_us() - cpu;
+  printf("idle:   %lu ms of CPU time in %lu ms\n", cpu / 1000,
+         (unsigned long)IDLE_TIME * 1000 / CLOCK_SECOND);
+
+  /* How late etimers fire */
+  total = max = 0;
+  for(i = 0; i < TIMER_ROUNDS; i++) {
+    interval = 1 + random_rand() % 20;
+    start = now_us();
+    etimer_set(&et, interval);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    late = now_us() - start - interval * 1000000UL / CLOCK_SECOND;
+    /* The clock ticks in milliseconds, so a timer may also fire early. */
+    if((long)late < 0) {
+      late = 0;
+    }
+    total += late;
+    if(late > max) {
+      max = late;
+    }
+  }
+  printf("etimer: %lu us late on average, %lu us max\n",
+         total / TIMER_ROUNDS, max);
+
+  /* Latency of data arriving on a file descriptor */
+  if(pipe(pipefd) < 0 || !select_set_callback(pipefd[0], &pipe_callback)) {
+    printf("pipe: could not create pipe\n");
+    PROCESS_EXIT();
+  }
+  cpu = cpu_us();
+  writer = fork();
+  if(writer == 0) {
+    write_stamps();
+  }
+  while(pipe_count < PIPE_ROUNDS) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    if(waitpid(writer, NULL, WNOHANG) == writer) {
+      break;
+    }
+  }
+  cpu = cpu_us() - cpu;
+  select_set_callback(pipefd[0], NULL);
+  printf("pipe:   %lu us latency on average, %lu us max, %lu ms of CPU time\n",
+         pipe_count > 0 ? pipe_total / pipe_count : 0, pipe_max, cpu / 1000);
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
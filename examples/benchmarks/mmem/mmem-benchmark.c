@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Stress benchmark of the managed memory allocator: randomly
+ *         allocates and frees blocks of varying sizes, checks that
+ *         their contents survive compaction and reports the time
+ *         spent and the resulting fragmentation.
+ */
+
+#include "contiki.h"
+#include "lib/mmem.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef NUM_HANDLES
+#define NUM_HANDLES 64
+#endif
+
+#ifndef ITERATIONS
+#define ITERATIONS 200000UL
+#endif
+
+/* Let the mmem process run after this many operations. */
+#define ROUND 1000
+
+#define MIN_SIZE 8
+#define MAX_SIZE 600
+
+static struct mmem handles[NUM_HANDLES];
+static char allocated[NUM_HANDLES];
+/*---------------------------------------------------------------------------*/
+static int
+check(int i)
+{
+  unsigned char *p;
+  unsigned int j;
+
+  p = (unsigned char *)MMEM_PTR(&handles[i]);
+  for(j = 0; j < handles[i].size; j++) {
+    if(p[j] != (unsigned char)i) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mmem_benchmark_process, "Managed memory benchmark");
+AUTOSTART_PROCESSES(&mmem_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_benchmark_process, ev, data)
+{
+  static clock_time_t start, elapsed;
+  static unsigned long n, failed, corrupt;
+  static struct mmem_stats stats;
+  unsigned int size;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("mmem benchmark: %lu operations, %s\n", ITERATIONS,
+         MMEM_LAZY_COMPACTION ? "lazy compaction" : "compact on free");
+
+  mmem_init();
+  random_init(0);
+  failed = corrupt = elapsed = 0;
+  start = clock_time();
+
+  for(n = 0; n < ITERATIONS; n++) {
+    if(n > 0 && n % ROUND == 0) {
+      elapsed += clock_time() - start;
+      PROCESS_PAUSE();
+      start = clock_time();
+    }
+
+    i = random_rand() % NUM_HANDLES;
+    if(allocated[i]) {
+      if(!check(i)) {
+        corrupt++;
+      }
+      mmem_free(&handles[i]);
+      allocated[i] = 0;
+    } else {
+      size = MIN_SIZE + random_rand() % (MAX_SIZE - MIN_SIZE);
+      if(mmem_alloc(&handles[i], size)) {
+        memset(MMEM_PTR(&handles[i]), i, size);
+        allocated[i] = 1;
+      } else {
+        failed++;
+      }
+    }
+  }
+  elapsed += clock_time() - start;
+
+  mmem_get_stats(&stats);
+  printf("time:    %lu ms\n", (unsigned long)elapsed);
+  printf("failed:  %lu allocations\n", failed);
+  printf("corrupt: %lu blocks\n", corrupt);
+  printf("free:    %u bytes, largest %u, %u holes\n",
+         stats.free, stats.largest, stats.holes);
+  printf("moved:   %lu bytes\n", stats.moved);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
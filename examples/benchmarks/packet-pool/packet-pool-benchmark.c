@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the uIP packet pool: measures the time taken to
+ *         queue the packet in uip_buf while a neighbor is resolved and
+ *         to put it back, and checks that the packet survives other
+ *         packets being built in uip_buf meanwhile.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip-packetqueue.h"
+#if UIP_PACKET_POOL
+#include "net/ip/uip-packetpool.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+/* Number of packets queued for each size */
+#define ROUNDS 1000000
+/* Number of those whose contents are checked after being restored */
+#define CHECKED_ROUNDS 1000
+
+/* Size of the neighbor solicitation built while the packet waits */
+#define NS_LEN 72
+
+static const uint16_t sizes[] = { 100, 640, UIP_BUFSIZE - UIP_LLH_LEN };
+static struct uip_packetqueue_handle handle;
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint16_t len, uint8_t seed)
+{
+  uint16_t i;
+
+  for(i = 0; i < len; i++) {
+    uip_buf[UIP_LLH_LEN + i] = seed + i;
+  }
+  uip_len = len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(uint16_t len, uint8_t seed)
+{
+  uint16_t i;
+
+  if(uip_len != len) {
+    return 0;
+  }
+  for(i = 0; i < len; i++) {
+    if(uip_buf[UIP_LLH_LEN + i] != (uint8_t)(seed + i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+park(void)
+{
+  uip_packetqueue_save(&handle, CLOCK_SECOND);
+  /* The neighbor solicitation is built in uip_buf meanwhile. */
+  memset(&uip_buf[UIP_LLH_LEN], 0xff, NS_LEN);
+  uip_len = NS_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t len)
+{
+  clock_time_t start;
+  unsigned long ns, errors;
+  int i;
+
+  errors = 0;
+  for(i = 0; i < CHECKED_ROUNDS; i++) {
+    fill(len, i);
+    park();
+    if(!uip_packetqueue_restore(&handle) || !check(len, i)) {
+      errors++;
+    }
+  }
+
+  fill(len, 0);
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    uip_len = len;
+    park();
+    uip_packetqueue_restore(&handle);
+  }
+  ns = (unsigned long)(clock_time() - start) * 1000000UL / ROUNDS;
+
+  printf("%4u bytes: %lu ns per packet queued and restored (%lu errors)\n",
+         len, ns, errors);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(packet_pool_benchmark_process, "Packet pool benchmark");
+AUTOSTART_PROCESSES(&packet_pool_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(packet_pool_benchmark_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("packet pool benchmark: %s\n",
+         UIP_PACKET_POOL ? "packet pool" : "copy");
+
+  uip_packetqueue_new(&handle);
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+#if UIP_PACKET_POOL
+  printf("%d of %d buffers free\n", uip_packetpool_numfree(),
+         UIP_PACKET_POOL);
+#endif
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
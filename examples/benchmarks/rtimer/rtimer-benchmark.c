@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the real-time timer: runs a periodic rtimer and
+ *         prints a histogram of how late each expiration was.
+ */
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+#ifndef NUM_SAMPLES
+#define NUM_SAMPLES 2000
+#endif
+
+/* The period is rounded to whole rtimer ticks */
+#ifndef PERIOD_US
+#define PERIOD_US 2000
+#endif
+#define PERIOD ((rtimer_clock_t)((uint64_t)PERIOD_US * RTIMER_SECOND / 1000000))
+
+/* Upper bounds of the lateness buckets, in microseconds */
+static const unsigned long bucket_limit[] = {
+  10, 50, 100, 250, 500, 1000, 2000, 5000
+};
+#define NUM_BUCKETS (sizeof(bucket_limit) / sizeof(bucket_limit[0]) + 1)
+
+static struct rtimer rt;
+static unsigned long histogram[NUM_BUCKETS];
+static unsigned long samples;
+static unsigned long worst_us;
+static unsigned long long total_us;
+/*---------------------------------------------------------------------------*/
+PROCESS(rtimer_benchmark_process, "Real-time timer benchmark");
+AUTOSTART_PROCESSES(&rtimer_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static void
+expired(struct rtimer *t, void *ptr)
+{
+  rtimer_clock_t now;
+  unsigned long late_us;
+  unsigned i;
+
+  now = RTIMER_NOW();
+  late_us = (unsigned long)((uint64_t)(rtimer_clock_t)(now - RTIMER_TIME(t)) *
+                            1000000 / RTIMER_SECOND);
+
+  for(i = 0; i < NUM_BUCKETS - 1 && late_us >= bucket_limit[i]; i++);
+  histogram[i]++;
+  total_us += late_us;
+  if(late_us > worst_us) {
+    worst_us = late_us;
+  }
+
+  if(++samples < NUM_SAMPLES) {
+    /* Schedule from the previous deadline so that lateness does not
+       accumulate */
+    rtimer_set(t, RTIMER_TIME(t) + PERIOD, 1, expired, NULL);
+  } else {
+    process_poll(&rtimer_benchmark_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rtimer_benchmark_process, ev, data)
+{
+  static unsigned i;
+
+  PROCESS_BEGIN();
+
+  printf("rtimer benchmark: %u samples, period %lu ticks, %lu ticks/s\n",
+         NUM_SAMPLES, (unsigned long)PERIOD, (unsigned long)RTIMER_SECOND);
+
+  rtimer_set(&rt, RTIMER_NOW() + PERIOD, 1, expired, NULL);
+  PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+  printf("lateness histogram:\n");
+  for(i = 0; i < NUM_BUCKETS; i++) {
+    if(i < NUM_BUCKETS - 1) {
+      printf("  < %5lu us: %lu\n", bucket_limit[i], histogram[i]);
+    } else {
+      printf("  >=%5lu us: %lu\n", bucket_limit[i - 1], histogram[i]);
+    }
+  }
+  printf("mean %lu us, worst %lu us\n",
+         (unsigned long)(total_us / samples), worst_us);
+  printf("done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
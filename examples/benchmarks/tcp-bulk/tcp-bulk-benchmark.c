@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Bulk TCP transfer between two minimal-net nodes: the sender
+ *         pushes TCP_BULK_SIZE bytes through a tcp_socket to the
+ *         receiver, which checks the byte pattern, and both report
+ *         the time taken.
+ *
+ *         The two nodes need their tap interfaces on one link, e.g.
+ *         bridged together:
+ *
+ *         ip link add br0 type bridge; ip link set br0 up
+ *         ip link set tap0 master br0; ip link set tap0 up
+ *         ip link set tap1 master br0; ip link set tap1 up
+ *
+ *         and loss can be added on the bridge ports with tc netem.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "tcp-socket.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PORT 8080
+
+#ifndef TCP_BULK_SIZE
+#define TCP_BULK_SIZE (1024UL * 1024)
+#endif
+
+static struct tcp_socket socket;
+
+static uint8_t inputbuf[UIP_TCP_MSS];
+static uint8_t outputbuf[16 * 1024];
+
+static unsigned long bytes;
+static unsigned long errors;
+static clock_time_t start;
+
+PROCESS(tcp_bulk_process, "TCP bulk benchmark");
+AUTOSTART_PROCESSES(&tcp_bulk_process);
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what)
+{
+  clock_time_t elapsed = clock_time() - start;
+
+  if(elapsed == 0) {
+    elapsed = 1;
+  }
+  printf("%s %lu bytes in %lu ms (%lu kB/s), %lu errors\n", what,
+         bytes, (unsigned long)elapsed,
+         (unsigned long)(bytes / elapsed * CLOCK_SECOND / 1024), errors);
+}
+/*---------------------------------------------------------------------------*/
+#if TCP_BULK_RECEIVER
+static int
+input(struct tcp_socket *s, void *ptr,
+      const uint8_t *inputptr, int inputdatalen)
+{
+  int i;
+
+  if(bytes == 0) {
+    start = clock_time();
+  }
+  for(i = 0; i < inputdatalen; i++) {
+    if(inputptr[i] != (uint8_t)(bytes + i)) {
+      errors++;
+    }
+  }
+  bytes += inputdatalen;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+  if(ev == TCP_SOCKET_CONNECTED) {
+    bytes = errors = 0;
+  } else if(ev == TCP_SOCKET_CLOSED) {
+    report("received");
+  }
+}
+#else /* TCP_BULK_RECEIVER */
+static void
+fill(struct tcp_socket *s)
+{
+  static unsigned long queued;
+  uint8_t buf[256];
+  int i, len;
+
+  if(s == NULL) {
+    queued = 0;
+    return;
+  }
+  while(queued < TCP_BULK_SIZE && tcp_socket_max_sendlen(s) > 0) {
+    len = MIN(sizeof(buf), TCP_BULK_SIZE - queued);
+    for(i = 0; i < len; i++) {
+      buf[i] = (uint8_t)(queued + i);
+    }
+    len = tcp_socket_send(s, buf, len);
+    queued += len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *s, void *ptr,
+      const uint8_t *inputptr, int inputdatalen)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+  if(ev == TCP_SOCKET_CONNECTED) {
+    start = clock_time();
+    bytes = 0;
+    fill(NULL);
+    fill(s);
+  } else if(ev == TCP_SOCKET_DATA_SENT) {
+    bytes = TCP_BULK_SIZE - s->output_data_len;
+    fill(s);
+    bytes = TCP_BULK_SIZE - s->output_data_len;
+    if(bytes == TCP_BULK_SIZE) {
+      report("sent");
+      tcp_socket_close(s);
+    }
+  } else if(ev == TCP_SOCKET_TIMEDOUT || ev == TCP_SOCKET_ABORTED) {
+    printf("connection lost after %lu bytes\n", bytes);
+  }
+}
+#endif /* TCP_BULK_RECEIVER */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_bulk_process, ev, data)
+{
+#if !TCP_BULK_RECEIVER
+  static struct etimer et;
+  uip_ipaddr_t addr;
+#endif /* !TCP_BULK_RECEIVER */
+
+  PROCESS_BEGIN();
+
+  printf("TCP send window %u bytes\n", UIP_TCP_SEND_WINDOW);
+
+  tcp_socket_register(&socket, NULL,
+                      inputbuf, sizeof(inputbuf),
+                      outputbuf, sizeof(outputbuf),
+                      input, event);
+
+#if TCP_BULK_RECEIVER
+  tcp_socket_listen(&socket, PORT);
+#else /* TCP_BULK_RECEIVER */
+  /* Give address autoconfiguration time to settle. */
+  etimer_set(&et, 3 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  uip_ip6addr(&addr, 0xfdfd, 0, 0, 0, 0, 0x00ff, 0xfe00, 0x0011);
+  tcp_socket_connect(&socket, &addr, PORT);
+#endif /* TCP_BULK_RECEIVER */
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -56,6 +56,17 @@ void nbr_print_stat(void);
 /*---------------------------------------------------------------------------*/
 PROCESS(border_router_cmd_process, "Border router cmd process");
 /*---------------------------------------------------------------------------*/
+static void
+print_slip_queue_stat(void)
+{
+  printf("SLIP queue: %d bytes in %d frames, max %d bytes\n",
+         slip_queued_bytes(), slip_queued_frames(), slip_max_queued);
+  printf("SLIP frames sent: %ld in %ld writes, %ld stalled, %ld dropped\n",
+         slip_frames_sent, slip_writes, slip_stalls, slip_dropped);
+  printf("Radio reports: %ld timed out, %ld dropped with no free session\n",
+         br_rdc_timeouts, br_rdc_dropped);
+}
+/*---------------------------------------------------------------------------*/
 /* TODO: the below code needs some way of identifying from where the command */
 /* comes. In this case it can be from stdin or from SLIP.                    */
 /*---------------------------------------------------------------------------*/
@@ -113,6 +124,9 @@ border_router_cmd_handler(const uint8_t *data, int len)
     } else if(data[1] == 'S') {
       border_router_print_stat();
       return 1;
+    } else if(data[1] == 'Q') {
+      print_slip_queue_stat();
+      return 1;
     }
   }
   return 0;
@@ -41,6 +41,7 @@
 #include "net/queuebuf.h"
 #include "net/netstack.h"
 #include "packetutils.h"
+#include "lib/list.h"
 #include "border-router.h"
 #include <string.h>
 
@@ -52,58 +53,146 @@
 #define PRINTF(...)
 #endif
 
+/*
+ * Up to BR_RDC_WINDOW frames are in flight to the slip-radio at the
+ * same time, each waiting for its !R report under its own session id.
+ * Further frames wait in a queue until a report frees up the window,
+ * and are dropped when all MAX_CALLBACKS sessions are in use.
+ */
 #define MAX_CALLBACKS 16
-static int callback_pos;
+
+#ifdef BORDER_ROUTER_RDC_CONF_WINDOW
+#define BR_RDC_WINDOW BORDER_ROUTER_RDC_CONF_WINDOW
+#else
+#define BR_RDC_WINDOW 4
+#endif
+
+/* A frame that the slip-radio has not reported within this time is
+   reported as failed */
+#ifdef BORDER_ROUTER_RDC_CONF_TIMEOUT
+#define BR_RDC_TIMEOUT BORDER_ROUTER_RDC_CONF_TIMEOUT
+#else
+#define BR_RDC_TIMEOUT CLOCK_SECOND
+#endif
+
+/* 3 bytes per packet attribute is required for serialization */
+#define BR_RDC_FRAME_SIZE (PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3)
+
+enum {
+  TX_FREE,
+  TX_QUEUED,
+  TX_IN_FLIGHT,
+};
 
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
+  struct tx_callback *next;
   mac_callback_t cback;
   void *ptr;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  struct ctimer timeout;
+  uint8_t state;
+  uint8_t sid;
+  uint16_t len;
+  uint8_t buf[BR_RDC_FRAME_SIZE];
 };
 
 static struct tx_callback callbacks[MAX_CALLBACKS];
+LIST(tx_queue);
+static int in_flight;
+static uint8_t next_sid;
+
+/* for statistics */
+long br_rdc_timeouts = 0;
+long br_rdc_dropped = 0;
+/*---------------------------------------------------------------------------*/
+static void tx_timeout(void *ptr);
+/*---------------------------------------------------------------------------*/
+static void
+transmit(struct tx_callback *callback)
+{
+  callback->sid = next_sid++;
+  callback->buf[2] = callback->sid;
+  callback->state = TX_IN_FLIGHT;
+  in_flight++;
+  ctimer_set(&callback->timeout, BR_RDC_TIMEOUT, tx_timeout, callback);
+
+  write_to_slip(callback->buf, callback->len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmit_queued(void)
+{
+  struct tx_callback *callback;
+
+  while(in_flight < BR_RDC_WINDOW &&
+        (callback = list_pop(tx_queue)) != NULL) {
+    transmit(callback);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_done(struct tx_callback *callback, uint8_t status, uint8_t tx)
+{
+  ctimer_stop(&callback->timeout);
+  callback->state = TX_FREE;
+  in_flight--;
+
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
+  mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
+
+  transmit_queued();
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_timeout(void *ptr)
+{
+  struct tx_callback *callback = ptr;
+
+  PRINTF("br-rdc: no report for session id %d\n", callback->sid);
+  br_rdc_timeouts++;
+  tx_done(callback, MAC_TX_ERR, 1);
+}
 /*---------------------------------------------------------------------------*/
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
 {
-  if(sessionid < MAX_CALLBACKS) {
-    struct tx_callback *callback;
-    callback = &callbacks[sessionid];
-    packetbuf_clear();
-    packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
-    mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
-  } else {
-    PRINTF("*** ERROR: too high session id %d\n", sessionid);
+  int i;
+
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    if(callbacks[i].state == TX_IN_FLIGHT && callbacks[i].sid == sessionid) {
+      tx_done(&callbacks[i], status, tx);
+      return;
+    }
   }
+  PRINTF("*** ERROR: unknown session id %d\n", sessionid);
 }
 /*---------------------------------------------------------------------------*/
-static int
+static struct tx_callback *
 setup_callback(mac_callback_t sent, void *ptr)
 {
   struct tx_callback *callback;
-  int tmp = callback_pos;
-  callback = &callbacks[callback_pos];
-  callback->cback = sent;
-  callback->ptr = ptr;
-  packetbuf_attr_copyto(callback->attrs, callback->addrs);
-
-  callback_pos++;
-  if(callback_pos >= MAX_CALLBACKS) {
-    callback_pos = 0;
-  }
+  int i;
 
-  return tmp;
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    callback = &callbacks[i];
+    if(callback->state == TX_FREE) {
+      callback->cback = sent;
+      callback->ptr = ptr;
+      packetbuf_attr_copyto(callback->attrs, callback->addrs);
+      return callback;
+    }
+  }
+  return NULL;
 }
 /*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   int size;
-  /* 3 bytes per packet attribute is required for serialization */
-  uint8_t buf[PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3];
-  uint8_t sid;
+  struct tx_callback *callback;
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
 
@@ -115,35 +204,83 @@ send_packet(mac_callback_t sent, void *ptr)
     PRINTF("br-rdc: send failed, too large header\n");
     mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
 
+  } else if((callback = setup_callback(sent, ptr)) == NULL) {
+    PRINTF("br-rdc: send failed, all sessions in use\n");
+    br_rdc_dropped++;
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+
   } else {
     /* here we send the data over SLIP to the radio-chip */
     size = 0;
 #if SERIALIZE_ATTRIBUTES
-    size = packetutils_serialize_atts(&buf[3], sizeof(buf) - 3);
+    size = packetutils_serialize_atts(&callback->buf[3],
+                                      sizeof(callback->buf) - 3);
 #endif
-    if(size < 0 || size + packetbuf_totlen() + 3 > sizeof(buf)) {
+    if(size < 0 || size + packetbuf_totlen() + 3 > sizeof(callback->buf)) {
       PRINTF("br-rdc: send failed, too large header\n");
       mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
     } else {
-      sid = setup_callback(sent, ptr);
-
-      buf[0] = '!';
-      buf[1] = 'S';
-      buf[2] = sid; /* sequence or session number for this packet */
+      callback->buf[0] = '!';
+      callback->buf[1] = 'S';
+      /* buf[2] is the session id, set when the frame is transmitted */
 
       /* Copy packet data */
-      memcpy(&buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
+      memcpy(&callback->buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
+      callback->len = packetbuf_totlen() + size + 3;
+
+      /* Keep the frames in order behind those already waiting */
+      callback->state = TX_QUEUED;
+      list_add(tx_queue, callback);
+      transmit_queued();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The number of frames of the neighbor ptr that wait for a report, and
+   whether the frame with the MAC sequence number seqno is one of them */
+static int
+pending(void *ptr, packetbuf_attr_t seqno, int *found)
+{
+  int i, count;
 
-      write_to_slip(buf, packetbuf_totlen() + size + 3);
+  count = 0;
+  *found = 0;
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    if(callbacks[i].state != TX_FREE && callbacks[i].ptr == ptr) {
+      count++;
+      if(callbacks[i].attrs[PACKETBUF_ATTR_MAC_SEQNO].val == seqno) {
+        *found = 1;
+      }
     }
   }
+  return count;
 }
 /*---------------------------------------------------------------------------*/
 static void
 send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 {
-  if(buf_list != NULL) {
-    queuebuf_to_packetbuf(buf_list->buf);
+  struct rdc_buf_list *b, *next;
+  int count, found;
+
+  /* The MAC layer calls send_list() again from the new head each time
+     a frame has been reported, and finds the reported frame by its
+     sequence number. Frames that already wait for a report are
+     skipped, and up to BR_RDC_WINDOW frames of the list are sent
+     without waiting for the reports of the earlier ones. Only the
+     head is failed when no session is free. */
+  for(b = buf_list; b != NULL; b = next) {
+    /* A frame that fails right away is removed from the list */
+    next = list_item_next(b);
+    count = pending(ptr, queuebuf_attr(b->buf, PACKETBUF_ATTR_MAC_SEQNO),
+                    &found);
+    if(found) {
+      continue;
+    }
+    if(count >= BR_RDC_WINDOW ||
+       (b != buf_list && in_flight + list_length(tx_queue) >= MAX_CALLBACKS)) {
+      break;
+    }
+    queuebuf_to_packetbuf(b->buf);
     send_packet(sent, ptr);
   }
 }
@@ -179,7 +316,8 @@ channel_check_interval(void)
 static void
 init(void)
 {
-  callback_pos = 0;
+  list_init(tx_queue);
+  in_flight = 0;
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver border_router_rdc_driver = {
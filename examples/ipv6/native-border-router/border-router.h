@@ -44,6 +44,19 @@
 int border_router_cmd_handler(const uint8_t *data, int len);
 int slip_config_handle_arguments(int argc, char **argv);
 void write_to_slip(const uint8_t *buf, int len);
+int slip_queued_bytes(void);
+int slip_queued_frames(void);
+
+/* SLIP output statistics */
+extern long slip_frames_sent;
+extern long slip_writes;
+extern long slip_stalls;
+extern long slip_dropped;
+extern int slip_max_queued;
+
+/* border-router-rdc statistics */
+extern long br_rdc_timeouts;
+extern long br_rdc_dropped;
 
 void border_router_set_prefix_64(const uip_ipaddr_t *prefix_64);
 void border_router_set_mac(const uint8_t *data);
@@ -42,7 +42,12 @@
 #undef UIP_CONF_RECEIVE_WINDOW
 #define UIP_CONF_RECEIVE_WINDOW  60
 
+/* Reassemble fragmented packets from several motes at the same time */
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 8
+
+#ifndef SLIP_DEV_CONF_SEND_DELAY
 #define SLIP_DEV_CONF_SEND_DELAY (CLOCK_SECOND / 32)
+#endif /* SLIP_DEV_CONF_SEND_DELAY */
 
 #undef WEBSERVER_CONF_CFS_CONNS
 #define WEBSERVER_CONF_CFS_CONNS 2
@@ -46,6 +46,7 @@
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -280,73 +281,176 @@ serial_input(FILE *inslip)
   goto read_more;
 }
 
-unsigned char slip_buf[2048];
-int slip_end, slip_begin, slip_packet_end, slip_packet_count;
-static struct timer send_delay_timer;
+/*
+ * Escaped frames are queued in a ring buffer and written with writev(),
+ * several frames per call when there is no delay between frames.
+ * The positions are free running, so SLIP_BUF_SIZE and SLIP_MAX_FRAMES
+ * must be powers of two.
+ */
+#ifdef SLIP_DEV_CONF_BUF_SIZE
+#define SLIP_BUF_SIZE SLIP_DEV_CONF_BUF_SIZE
+#else
+#define SLIP_BUF_SIZE 8192
+#endif
+
+/* The number of frames that can be queued */
+#ifdef SLIP_DEV_CONF_MAX_FRAMES
+#define SLIP_MAX_FRAMES SLIP_DEV_CONF_MAX_FRAMES
+#else
+#define SLIP_MAX_FRAMES 32
+#endif
+
+#if (SLIP_BUF_SIZE & (SLIP_BUF_SIZE - 1)) != 0
+#error SLIP_DEV_CONF_BUF_SIZE must be a power of two
+#endif
+#if (SLIP_MAX_FRAMES & (SLIP_MAX_FRAMES - 1)) != 0
+#error SLIP_DEV_CONF_MAX_FRAMES must be a power of two
+#endif
+
+static unsigned char slip_buf[SLIP_BUF_SIZE];
+/* Position of the next byte to queue and of the next byte to write */
+static unsigned slip_head, slip_tail;
+/* Position just after the SLIP_END of each queued frame */
+static unsigned slip_frame_end[SLIP_MAX_FRAMES];
+static unsigned slip_frame_head, slip_frame_tail;
+
+/* The escape code of each byte, or zero if it is sent as is */
+static const unsigned char slip_escape[256] = {
+  [SLIP_END] = SLIP_ESC_END,
+  [SLIP_ESC] = SLIP_ESC_ESC,
+};
+
+/* for statistics */
+long slip_frames_sent = 0;
+long slip_writes = 0;
+long slip_stalls = 0;
+long slip_dropped = 0;
+int slip_max_queued = 0;
+
+/* A ctimer, so that the main loop wakes up when the delay is over */
+static struct ctimer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
 static void
-slip_send(int fd, unsigned char c)
+send_delay_over(void *ptr)
 {
-  if(slip_end >= sizeof(slip_buf)) {
-    err(1, "slip_send overflow");
+  /* The next packet is written when slipfd is writable. */
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_queued_bytes(void)
+{
+  return slip_head - slip_tail;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_queued_frames(void)
+{
+  return slip_frame_head - slip_frame_tail;
+}
+/*---------------------------------------------------------------------------*/
+static void
+slip_put(const unsigned char *data, unsigned len)
+{
+  unsigned pos = slip_head % SLIP_BUF_SIZE;
+  unsigned first = len < SLIP_BUF_SIZE - pos ? len : SLIP_BUF_SIZE - pos;
+
+  memcpy(slip_buf + pos, data, first);
+  memcpy(slip_buf, data + first, len - first);
+  slip_head += len;
+}
+/*---------------------------------------------------------------------------*/
+/* Queues a SLIP frame with the data escaped */
+static void
+slip_send_frame(const unsigned char *data, int len)
+{
+  static const unsigned char end = SLIP_END;
+  unsigned char esc[2];
+  int escaped_len;
+  int i, j;
+
+  escaped_len = len + 1;
+  for(i = 0; i < len; i++) {
+    if(slip_escape[data[i]]) {
+      escaped_len++;
+    }
   }
-  slip_buf[slip_end] = c;
-  slip_end++;
-  slip_sent++;
-  if(c == SLIP_END) {
-    /* Full packet received. */
-    slip_packet_count++;
-    if(slip_packet_end == 0) {
-      slip_packet_end = slip_end;
+
+  if(slip_queued_frames() == SLIP_MAX_FRAMES ||
+     slip_queued_bytes() + escaped_len > SLIP_BUF_SIZE) {
+    PROGRESS("D");
+    slip_dropped++;
+    return;
+  }
+
+  /* Copy the runs between bytes that need escaping as they are */
+  esc[0] = SLIP_ESC;
+  for(i = 0; i < len; i = j + 1) {
+    for(j = i; j < len && !slip_escape[data[j]]; j++);
+    slip_put(data + i, j - i);
+    if(j < len) {
+      esc[1] = slip_escape[data[j]];
+      slip_put(esc, 2);
     }
   }
+  slip_put(&end, 1);
+
+  slip_frame_end[slip_frame_head % SLIP_MAX_FRAMES] = slip_head;
+  slip_frame_head++;
+  if(slip_queued_bytes() > slip_max_queued) {
+    slip_max_queued = slip_queued_bytes();
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
 slip_empty()
 {
-  return slip_packet_end == 0;
+  return slip_head == slip_tail;
 }
 /*---------------------------------------------------------------------------*/
 void
 slip_flushbuf(int fd)
 {
+  struct iovec iov[2];
+  unsigned pos, len;
   int n;
 
   if(slip_empty()) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, slip_packet_end - slip_begin);
+  /* With a delay between packets, only write up to the end of the
+     first frame */
+  if(send_delay > 0) {
+    len = slip_frame_end[slip_frame_tail % SLIP_MAX_FRAMES] - slip_tail;
+  } else {
+    len = slip_head - slip_tail;
+  }
+  pos = slip_tail % SLIP_BUF_SIZE;
+  iov[0].iov_base = slip_buf + pos;
+  iov[0].iov_len = len < SLIP_BUF_SIZE - pos ? len : SLIP_BUF_SIZE - pos;
+  iov[1].iov_base = slip_buf;
+  iov[1].iov_len = len - iov[0].iov_len;
+
+  n = writev(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+  slip_writes++;
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueue is full! */
+    slip_stalls++;
   } else {
-    slip_begin += n;
-    if(slip_begin == slip_packet_end) {
-      slip_packet_count--;
-      if(slip_end > slip_packet_end) {
-        memcpy(slip_buf, slip_buf + slip_packet_end,
-               slip_end - slip_packet_end);
-      }
-      slip_end -= slip_packet_end;
-      slip_begin = slip_packet_end = 0;
-      if(slip_end > 0) {
-        /* Find end of next slip packet */
-        for(n = 1; n < slip_end; n++) {
-          if(slip_buf[n] == SLIP_END) {
-            slip_packet_end = n + 1;
-            break;
-          }
-        }
-        /* a delay between slip packets to avoid losing data */
-        if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
-        }
+    slip_tail += n;
+    slip_sent += n;
+    while(slip_frame_tail != slip_frame_head &&
+          (int)(slip_tail - slip_frame_end[slip_frame_tail % SLIP_MAX_FRAMES]) >= 0) {
+      slip_frame_tail++;
+      slip_frames_sent++;
+      /* a delay between slip packets to avoid losing data */
+      if(send_delay > 0 && !slip_empty()) {
+        ctimer_set(&send_delay_timer, send_delay, send_delay_over, NULL);
       }
     }
   }
@@ -383,24 +487,8 @@ write_to_serial(int outfd, const uint8_t *inbuf, int len)
   /* It would be ``nice'' to send a SLIP_END here but it's not
    * really necessary.
    */
-  /* slip_send(outfd, SLIP_END); */
 
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
-    }
-  }
-  slip_send(outfd, SLIP_END);
+  slip_send_frame(p, len);
   PROGRESS("t");
 }
 /*---------------------------------------------------------------------------*/
@@ -449,8 +537,10 @@ stty_telos(int fd)
   tty.c_cflag |= CLOCAL;
   if(tcsetattr(fd, TCSAFLUSH, &tty) == -1) err(1, "tcsetattr");
 
+  /* Pseudo terminals, such as tools/slip-radio-loopback, have no
+     modem control lines */
   i = TIOCM_DTR;
-  if(ioctl(fd, TIOCMBIS, &i) == -1) err(1, "ioctl");
+  if(ioctl(fd, TIOCMBIS, &i) == -1 && errno != ENOTTY) err(1, "ioctl");
 #endif
 
   usleep(10*1000);		/* Wait for hardware 10ms. */
@@ -463,7 +553,7 @@ static int
 set_fd(fd_set *rset, fd_set *wset)
 {
   /* Anything to flush? */
-  if(!slip_empty() && (send_delay == 0 || timer_expired(&send_delay_timer))) {
+  if(!slip_empty() && (send_delay == 0 || ctimer_expired(&send_delay_timer))) {
     FD_SET(slipfd, wset);
   }
 
@@ -536,8 +626,7 @@ slip_init(void)
     stty_telos(slipfd);
   }
 
-  timer_set(&send_delay_timer, 0);
-  slip_send(slipfd, SLIP_END);
+  slip_send_frame(NULL, 0);
   inslip = fdopen(slipfd, "r");
   if(inslip == NULL) {
     err(1, "main: fdopen");
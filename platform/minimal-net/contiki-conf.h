@@ -156,6 +156,11 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_LOGGING              0
 #define UIP_CONF_UDP_CHECKSUMS        1
 
+/* Checksums are computed by cpu/native/net/uip_arch.c */
+#ifndef UIP_ARCH_CHKSUM
+#define UIP_ARCH_CHKSUM 1
+#endif /* UIP_ARCH_CHKSUM */
+
 /* Not used but avoids compile errors while sicslowpan.c is being developed */
 #define SICSLOWPAN_CONF_COMPRESSION       SICSLOWPAN_COMPRESSION_HC06
 
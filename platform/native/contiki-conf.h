@@ -44,6 +44,19 @@ struct select_callback {
 };
 int select_set_callback(int fd, const struct select_callback *callback);
 
+/*
+ * rtimers count microseconds of CLOCK_MONOTONIC and run from the main
+ * loop when their timerfd expires (see cpu/native/rtimer-arch.h).
+ */
+#if defined(__linux__) && !defined(RTIMER_ARCH_CONF_TIMERFD)
+#define RTIMER_ARCH_CONF_TIMERFD 1
+#endif
+
+#if RTIMER_ARCH_CONF_TIMERFD
+typedef uint32_t rtimer_clock_t;
+#define RTIMER_CLOCK_LT(a,b)     ((int32_t)((a)-(b)) < 0)
+#endif /* RTIMER_ARCH_CONF_TIMERFD */
+
 #define CC_CONF_REGISTER_ARGS          1
 #define CC_CONF_FUNCTION_POINTER_ARGS  1
 #define CC_CONF_VA_ARGS                1
@@ -74,6 +87,11 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_LOGGING         0
 #define UIP_CONF_UDP_CHECKSUMS   1
 
+/* Checksums are computed by cpu/native/net/uip_arch.c */
+#ifndef UIP_ARCH_CHKSUM
+#define UIP_ARCH_CHKSUM 1
+#endif /* UIP_ARCH_CHKSUM */
+
 #ifndef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8
 #endif /* NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE */
@@ -75,12 +75,50 @@
 #ifdef SELECT_CONF_MAX
 #define SELECT_MAX SELECT_CONF_MAX
 #else
-#define SELECT_MAX 8
+/* The rtimer timerfd and the network and serial devices are
+   registered, so leave room for them above stdin */
+#define SELECT_MAX 16
 #endif
 
+/*
+ * With SELECT_EPOLL, the main loop waits with epoll until a file
+ * descriptor is ready or the next etimer expires, instead of waking up
+ * every millisecond.
+ */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#elif defined(__linux__)
+#define SELECT_EPOLL 1
+#else
+#define SELECT_EPOLL 0
+#endif
+
+#if SELECT_EPOLL
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#endif /* SELECT_EPOLL */
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+#if SELECT_EPOLL
+static int epoll_fd = -1;
+/* The events each file descriptor is registered for */
+static uint32_t epoll_events[SELECT_MAX];
+/* Set for files that cannot be polled, such as regular files */
+static uint8_t epoll_unpollable[SELECT_MAX];
+/* Expires with the next etimer */
+static int timer_fd = -1;
+static clock_time_t timer_next;
+static uint8_t timer_armed;
+
+static void epoll_update(int fd, uint32_t events);
+#endif /* SELECT_EPOLL */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
@@ -100,6 +138,14 @@ select_set_callback(int fd, const struct select_callback *callback)
     }
 
     select_callback[fd] = callback;
+#if SELECT_EPOLL
+    if(callback == NULL && epoll_events[fd] != 0) {
+      /* A readable file left in the epoll set would wake up every
+         epoll_wait() */
+      epoll_update(fd, 0);
+    }
+    epoll_unpollable[fd] = 0;
+#endif /* SELECT_EPOLL */
 
     /* Update fd max */
     if(callback != NULL) {
@@ -120,6 +166,193 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+/* Returns non-zero if the next etimer has expired */
+static int
+etimer_due(void)
+{
+  clock_time_t next, now;
+
+  if(!etimer_pending()) {
+    return 0;
+  }
+  next = etimer_next_expiration_time();
+  now = clock_time();
+  return (clock_time_t)(now - next) <= (clock_time_t)(next - now);
+}
+/*---------------------------------------------------------------------------*/
+/* Arms the timerfd to expire with the next etimer */
+static void
+timer_update(void)
+{
+  struct itimerspec its;
+  struct timeval tv;
+  clock_time_t next, now;
+  unsigned long ms;
+
+  if(!etimer_pending()) {
+    if(timer_armed) {
+      memset(&its, 0, sizeof(its));
+      timerfd_settime(timer_fd, 0, &its, NULL);
+      timer_armed = 0;
+    }
+    return;
+  }
+
+  next = etimer_next_expiration_time();
+  if(timer_armed && next == timer_next) {
+    return;
+  }
+
+  /*
+   * clock_time() counts milliseconds of the real time clock, so the
+   * etimer expires when that clock reaches the millisecond next.
+   */
+  gettimeofday(&tv, NULL);
+  now = tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  ms = tv.tv_usec / 1000;
+  if((clock_time_t)(next - now) < (clock_time_t)(now - next)) {
+    ms += next - now;
+  }
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = tv.tv_sec + ms / 1000;
+  its.it_value.tv_nsec = (ms % 1000) * 1000000;
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+  timer_armed = 1;
+  timer_next = next;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_update(int fd, uint32_t events)
+{
+  struct epoll_event ev;
+  int op;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  if(events == 0) {
+    op = EPOLL_CTL_DEL;
+  } else if(epoll_events[fd] == 0) {
+    op = EPOLL_CTL_ADD;
+  } else {
+    op = EPOLL_CTL_MOD;
+  }
+
+  if(epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+    if(errno == ENOENT && op == EPOLL_CTL_MOD) {
+      /* The file was closed and its descriptor reused. */
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    } else if(errno == EPERM) {
+      epoll_unpollable[fd] = 1;
+    }
+  }
+  epoll_events[fd] = events;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * A drop-in replacement for select() on the sets filled by the
+ * select callbacks, which sleeps until a file descriptor is ready or
+ * the next etimer expires. Files that cannot be polled are always
+ * ready, as with select().
+ */
+static int
+epoll_select(fd_set *rset, fd_set *wset, int pending)
+{
+  struct epoll_event events[SELECT_MAX + 1];
+  uint64_t expirations;
+  uint32_t want;
+  int fd, i, n, ready, timeout;
+
+  /* Files that were not set this turn may still be in the epoll set
+     from an earlier one, so all registered files are brought up to
+     date */
+  ready = 0;
+  for(fd = 0; fd <= select_max; fd++) {
+    want = (FD_ISSET(fd, rset) ? EPOLLIN : 0) | (FD_ISSET(fd, wset) ? EPOLLOUT : 0);
+    if(want != epoll_events[fd] && !epoll_unpollable[fd]) {
+      epoll_update(fd, want);
+    }
+    if(epoll_unpollable[fd] && want != 0) {
+      ready++;
+    } else {
+      FD_CLR(fd, rset);
+      FD_CLR(fd, wset);
+    }
+  }
+
+  if(pending || ready || process_nevents() > 0 || etimer_due()) {
+    timeout = 0;
+  } else {
+    timer_update();
+#if WITH_GUI
+    /* The GUI checks if the console was resized at every turn. */
+    timeout = 1;
+#else /* WITH_GUI */
+    timeout = -1;
+#endif /* WITH_GUI */
+  }
+
+  n = epoll_wait(epoll_fd, events, SELECT_MAX + 1, timeout);
+  if(n < 0) {
+    return n;
+  }
+  for(i = 0; i < n; i++) {
+    fd = events[i].data.fd;
+    if(fd == timer_fd) {
+      if(read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+        timer_armed = 0;
+      }
+      continue;
+    }
+    if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) &&
+       epoll_events[fd] & EPOLLIN) {
+      FD_SET(fd, rset);
+      ready++;
+    }
+    if(events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR) &&
+       epoll_events[fd] & EPOLLOUT) {
+      FD_SET(fd, wset);
+      ready++;
+    }
+  }
+  return ready;
+}
+/*---------------------------------------------------------------------------*/
+/* Move an internal file descriptor out of the range that
+   select_set_callback() accepts, so it does not take the place of a
+   device */
+static int
+fd_above_select_max(int fd)
+{
+  int high;
+
+  if(fd < 0 || fd >= SELECT_MAX) {
+    return fd;
+  }
+  high = fcntl(fd, F_DUPFD_CLOEXEC, SELECT_MAX);
+  close(fd);
+  return high;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_init(void)
+{
+  struct epoll_event ev;
+
+  epoll_fd = fd_above_select_max(epoll_create(SELECT_MAX + 1));
+  timer_fd = fd_above_select_max(timerfd_create(CLOCK_REALTIME, 0));
+  if(epoll_fd < 0 || timer_fd < 0) {
+    perror("epoll_init");
+    exit(1);
+  }
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = timer_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
 static int
 stdin_set_fd(fd_set *rset, fd_set *wset)
 {
@@ -130,9 +363,14 @@ static void
 stdin_handle_fd(fd_set *rset, fd_set *wset)
 {
   char c;
+  int n;
   if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
+    n = read(STDIN_FILENO, &c, 1);
+    if(n > 0) {
       serial_line_input_byte(c);
+    } else if(n == 0) {
+      /* End of file: stop polling stdin, it would always be ready. */
+      select_set_callback(STDIN_FILENO, NULL);
     }
   }
 }
@@ -140,6 +378,26 @@ const static struct select_callback stdin_fd = {
   stdin_set_fd, stdin_handle_fd
 };
 /*---------------------------------------------------------------------------*/
+#if RTIMER_ARCH_TIMERFD
+static int
+rtimer_set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(rtimer_arch_fd(), rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+rtimer_handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(FD_ISSET(rtimer_arch_fd(), rset)) {
+    rtimer_arch_run();
+  }
+}
+const static struct select_callback rtimer_fd = {
+  rtimer_set_fd, rtimer_handle_fd
+};
+#endif /* RTIMER_ARCH_TIMERFD */
+/*---------------------------------------------------------------------------*/
 static void
 set_rime_addr(void)
 {
@@ -249,19 +507,30 @@ main(int argc, char **argv)
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
+#if SELECT_EPOLL
+  epoll_init();
+#endif /* SELECT_EPOLL */
+
   select_set_callback(STDIN_FILENO, &stdin_fd);
+#if RTIMER_ARCH_TIMERFD
+  select_set_callback(rtimer_arch_fd(), &rtimer_fd);
+#endif /* RTIMER_ARCH_TIMERFD */
   while(1) {
     fd_set fdr;
     fd_set fdw;
     int maxfd;
     int i;
     int retval;
+#if !SELECT_EPOLL
     struct timeval tv;
+#endif /* !SELECT_EPOLL */
 
     retval = process_run();
 
+#if !SELECT_EPOLL
     tv.tv_sec = 0;
     tv.tv_usec = retval ? 1 : 1000;
+#endif /* !SELECT_EPOLL */
 
     FD_ZERO(&fdr);
     FD_ZERO(&fdw);
@@ -272,7 +541,11 @@ main(int argc, char **argv)
       }
     }
 
+#if SELECT_EPOLL
+    retval = epoll_select(&fdr, &fdw, retval);
+#else /* SELECT_EPOLL */
     retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+#endif /* SELECT_EPOLL */
     if(retval < 0) {
       if(errno != EINTR) {
         perror("select");
@@ -286,7 +559,13 @@ main(int argc, char **argv)
       }
     }
 
+#if SELECT_EPOLL
+    if(etimer_due()) {
+      etimer_request_poll();
+    }
+#else /* SELECT_EPOLL */
     etimer_request_poll();
+#endif /* SELECT_EPOLL */
 
 #if WITH_GUI
     if(console_resize()) {
@@ -0,0 +1,29 @@
+TIMEOUT(200000, log.log("last message: " + msg + "\n"));
+
+/* Mote 2 receives the fragmented broadcasts of the three other motes,
+   which are all sent at the same time. */
+receiver = 2;
+senders = 3;
+data = 0;
+alive = 0;
+while(true) {
+    YIELD();
+    if(id != receiver) {
+        continue;
+    }
+    if(msg.startsWith('Data')) {
+        data++;
+        log.log("Heard " + data + " data messages\n");
+    }
+    if(msg.startsWith('Alive')) {
+        alive++;
+        log.log("Heard " + alive + " alive messages\n");
+    }
+    if(alive == 10) {
+        if(data >= senders * (alive - 1)) {
+            log.testOK();
+        } else {
+            log.testError();
+        }
+    }
+}
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * A stand-in for the slip-radio example that runs on a pseudo terminal,
+ * for benchmarking the native border router without a mote. Frames sent
+ * with !S are reported with !R after the time that they would have taken
+ * over a serial line of the given baud rate and an 802.15.4 radio. With
+ * -n, the stand-in also acts as a node that pings the border router and
+ * reports how many echo replies per second came back.
+ *
+ *   slip-radio-loopback -n 1000
+ *   border-router.native -s pts/N aaaa::1/64
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <err.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+/* The 802.15.4 PAN id and radio time per byte at 250 kbit/s */
+#define PANID        0xabcd
+#define AIRTIME_BYTE 32
+/* PHY header and FCS around each frame */
+#define AIRTIME_OVERHEAD 8
+
+#define MAX_REPORTS 256
+#define ECHO_MARKER "slip-radio-loopback"
+/* Pings without a reply for this long are counted as lost */
+#define PING_TIMEOUT 100000
+
+static int ptyfd;
+/* Our end of the slave side, open until the border router has opened it */
+static int slave = -1;
+static unsigned baudrate = 115200;
+static unsigned airtime_byte = AIRTIME_BYTE;
+
+static const uint8_t radio_mac[8] = { 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t node_mac[8] = { 0x00, 0x12, 0x74, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static uint8_t frame_seqno;
+
+/* Reports waiting for their frame to be transmitted */
+static struct {
+  uint64_t time;
+  uint8_t sid;
+  /* The sequence number of the echo reply in the frame, or -1 */
+  int32_t echo_seq;
+} reports[MAX_REPORTS];
+static int report_head, report_count;
+static uint64_t serial_free, radio_free;
+
+static unsigned long pings, ping_preload = 8;
+static unsigned long pings_sent, replies, pings_lost;
+/* The sequence number of the next reply that is expected */
+static unsigned long ping_next;
+/* The rate is measured from the reply that ends the first round */
+static unsigned long replies_start;
+static uint64_t ping_start, ping_end, ping_progress;
+static unsigned long frames, frames_total_len;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+serial_time(int len)
+{
+  /* 10 bits per byte with start and stop bits */
+  return baudrate ? (uint64_t)len * 10 * 1000000 / baudrate : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_all(const uint8_t *data, int len)
+{
+  int n;
+
+  while(len > 0) {
+    n = write(ptyfd, data, len);
+    if(n < 0) {
+      if(errno == EAGAIN || errno == EINTR) {
+        continue;
+      }
+      err(1, "write");
+    }
+    data += n;
+    len -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+slip_write(const uint8_t *data, int len)
+{
+  uint8_t buf[2 * 1500 + 2];
+  int i, pos = 0;
+
+  buf[pos++] = SLIP_END;
+  for(i = 0; i < len && i < 1500; i++) {
+    if(data[i] == SLIP_END) {
+      buf[pos++] = SLIP_ESC;
+      buf[pos++] = SLIP_ESC_END;
+    } else if(data[i] == SLIP_ESC) {
+      buf[pos++] = SLIP_ESC;
+      buf[pos++] = SLIP_ESC_ESC;
+    } else {
+      buf[pos++] = data[i];
+    }
+  }
+  buf[pos++] = SLIP_END;
+  write_all(buf, pos);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+chksum(uint32_t sum, const uint8_t *data, int len)
+{
+  int i;
+
+  for(i = 0; i + 1 < len; i += 2) {
+    sum += (data[i] << 8) | data[i + 1];
+  }
+  if(len & 1) {
+    sum += data[len - 1] << 8;
+  }
+  while(sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_local(uint8_t *addr, const uint8_t *mac)
+{
+  memset(addr, 0, 16);
+  addr[0] = 0xfe;
+  addr[1] = 0x80;
+  memcpy(addr + 8, mac, 8);
+  addr[8] ^= 0x02;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends an ICMPv6 message from the node to the border router */
+static void
+send_icmp6(const uint8_t *icmp, int icmp_len, uint8_t hop_limit)
+{
+  uint8_t frame[127];
+  uint8_t *ip;
+  uint32_t sum;
+  uint16_t c;
+  int i, pos = 0;
+
+  /* Data frame with PAN id compression and long addresses */
+  frame[pos++] = 0x41;
+  frame[pos++] = 0xcc;
+  frame[pos++] = frame_seqno++;
+  frame[pos++] = PANID & 0xff;
+  frame[pos++] = PANID >> 8;
+  for(i = 7; i >= 0; i--) {
+    frame[pos++] = radio_mac[i];
+  }
+  for(i = 7; i >= 0; i--) {
+    frame[pos++] = node_mac[i];
+  }
+
+  /* Uncompressed IPv6 */
+  frame[pos++] = 0x41;
+  ip = &frame[pos];
+  memset(ip, 0, 40);
+  ip[0] = 0x60;
+  ip[4] = icmp_len >> 8;
+  ip[5] = icmp_len & 0xff;
+  ip[6] = 58;
+  ip[7] = hop_limit;
+  link_local(ip + 8, node_mac);
+  link_local(ip + 24, radio_mac);
+  pos += 40;
+
+  memcpy(&frame[pos], icmp, icmp_len);
+  frame[pos + 2] = frame[pos + 3] = 0;
+  sum = chksum(icmp_len + 58, ip + 8, 32);
+  c = ~chksum(sum, &frame[pos], icmp_len);
+  frame[pos + 2] = c >> 8;
+  frame[pos + 3] = c & 0xff;
+  pos += icmp_len;
+
+  slip_write(frame, pos);
+}
+/*---------------------------------------------------------------------------*/
+/* A DIO puts the node in the neighbor cache of the border router. Its
+   unsupported mode of operation keeps RPL from acting on it. */
+static void
+send_dio(void)
+{
+  uint8_t dio[28];
+
+  memset(dio, 0, sizeof(dio));
+  dio[0] = 155;
+  dio[1] = 1;
+  dio[4] = 0x1e;
+  dio[6] = dio[7] = 0xff;
+  dio[8] = 7 << 3;
+  send_icmp6(dio, sizeof(dio), 64);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_ping(void)
+{
+  uint8_t echo[8 + sizeof(ECHO_MARKER)];
+
+  echo[0] = 128;
+  echo[1] = 0;
+  echo[4] = 0x12;
+  echo[5] = 0x34;
+  echo[6] = pings_sent >> 8;
+  echo[7] = pings_sent & 0xff;
+  memcpy(echo + 8, ECHO_MARKER, sizeof(ECHO_MARKER));
+  send_icmp6(echo, sizeof(echo), 64);
+  pings_sent++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_report(uint8_t sid)
+{
+  uint8_t buf[5] = { '!', 'R', sid, 0 /* MAC_TX_OK */, 1 };
+
+  slip_write(buf, sizeof(buf));
+}
+/*---------------------------------------------------------------------------*/
+static void
+frame_input(const uint8_t *data, int len)
+{
+  const uint8_t *marker;
+  uint64_t now;
+  int i;
+
+  if(slave >= 0) {
+    /* Input to the slave side does not always reach the border router
+       while another file descriptor is open on it */
+    close(slave);
+    slave = -1;
+  }
+
+  if(len >= 2 && data[0] == '?' && data[1] == 'M') {
+    uint8_t buf[10] = { '!', 'M' };
+    memcpy(buf + 2, radio_mac, 8);
+    slip_write(buf, sizeof(buf));
+
+  } else if(len >= 3 && data[0] == '!' && data[1] == 'S') {
+    if(report_count == MAX_REPORTS) {
+      fprintf(stderr, "too many frames in flight, dropping %d\n", data[2]);
+      return;
+    }
+    frames++;
+    frames_total_len += len;
+
+    /* The frame is in the radio once it has crossed the serial line,
+       and is reported once the radio has transmitted it */
+    now = now_us();
+    serial_free = (serial_free > now ? serial_free : now) + serial_time(len + 2);
+    radio_free = (radio_free > serial_free ? radio_free : serial_free) +
+      (uint64_t)(len - 3 + AIRTIME_OVERHEAD) * airtime_byte;
+    i = (report_head + report_count) % MAX_REPORTS;
+    reports[i].time = radio_free;
+    reports[i].sid = data[2];
+    report_count++;
+
+    /* An echo reply reaches the node when the radio has sent it */
+    marker = memmem(data, len, ECHO_MARKER, sizeof(ECHO_MARKER));
+    reports[i].echo_seq = -1;
+    if(pings_sent > 0 && marker != NULL && marker >= data + 2) {
+      reports[i].echo_seq = (marker[-2] << 8) | marker[-1];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+echo_reply(uint16_t echo_seq, uint64_t time)
+{
+  unsigned long seq;
+
+  /* Replies come in order, so the pings before this one that have not
+     been answered were dropped */
+  seq = (ping_next & ~0xffffUL) | echo_seq;
+  if(seq + 0x8000 < ping_next) {
+    seq += 0x10000;
+  }
+  if(seq >= ping_next) {
+    pings_lost += seq - ping_next;
+    ping_next = seq + 1;
+  }
+  replies++;
+  ping_end = time;
+  ping_progress = now_us();
+  if(replies == ping_preload) {
+    ping_start = ping_end;
+    replies_start = replies;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+pty_input(void)
+{
+  static uint8_t buf[2048];
+  static size_t pos;
+  static int esc;
+  uint8_t in[4096];
+  int i, n;
+
+  n = read(ptyfd, in, sizeof(in));
+  if(n <= 0) {
+    return;
+  }
+  for(i = 0; i < n; i++) {
+    if(esc) {
+      esc = 0;
+      in[i] = in[i] == SLIP_ESC_END ? SLIP_END : SLIP_ESC;
+    } else if(in[i] == SLIP_ESC) {
+      esc = 1;
+      continue;
+    } else if(in[i] == SLIP_END) {
+      if(pos > 0) {
+        frame_input(buf, pos);
+      }
+      pos = 0;
+      continue;
+    }
+    if(pos < sizeof(buf)) {
+      buf[pos++] = in[i];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [options]\n", prog);
+  fprintf(stderr, "Options are:\n");
+  fprintf(stderr, " -B baudrate  Emulated serial line speed, 0 for none (default 115200)\n");
+  fprintf(stderr, " -a us        Radio time per byte (default %d)\n", AIRTIME_BYTE);
+  fprintf(stderr, " -n count     Ping the border router count times\n");
+  fprintf(stderr, " -l preload   Pings outstanding at the same time (default 8)\n");
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct termios tty;
+  struct pollfd pfd;
+  uint64_t now, mac_time = 0;
+  int c, timeout;
+
+  while((c = getopt(argc, argv, "B:a:n:l:h")) != -1) {
+    switch(c) {
+    case 'B':
+      baudrate = atoi(optarg);
+      break;
+    case 'a':
+      airtime_byte = atoi(optarg);
+      break;
+    case 'n':
+      pings = atol(optarg);
+      break;
+    case 'l':
+      ping_preload = atol(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  ptyfd = posix_openpt(O_RDWR | O_NOCTTY);
+  if(ptyfd < 0 || grantpt(ptyfd) < 0 || unlockpt(ptyfd) < 0) {
+    err(1, "posix_openpt");
+  }
+  /* Keep the slave side open and raw until the border router opens it */
+  slave = open(ptsname(ptyfd), O_RDWR | O_NOCTTY);
+  if(slave < 0 || tcgetattr(slave, &tty) < 0) {
+    err(1, "%s", ptsname(ptyfd));
+  }
+  cfmakeraw(&tty);
+  tcsetattr(slave, TCSANOW, &tty);
+  printf("slip-radio-loopback on %s\n", ptsname(ptyfd) + strlen("/dev/"));
+  fflush(stdout);
+
+  pfd.fd = ptyfd;
+  pfd.events = POLLIN;
+  while(1) {
+    now = now_us();
+
+    while(report_count > 0 && reports[report_head].time <= now) {
+      send_report(reports[report_head].sid);
+      if(reports[report_head].echo_seq >= 0) {
+        echo_reply(reports[report_head].echo_seq, reports[report_head].time);
+      }
+      report_head = (report_head + 1) % MAX_REPORTS;
+      report_count--;
+    }
+
+    if(pings > 0) {
+      if(mac_time == 0 && radio_free > 0) {
+        /* Give the border router time to configure its address */
+        mac_time = now + 1000000;
+      } else if(mac_time != 0 && now >= mac_time) {
+        if(pings_sent == 0) {
+          send_dio();
+          ping_progress = now;
+        }
+        if(pings_sent > ping_next && now > ping_progress + PING_TIMEOUT) {
+          /* The border router dropped them, send new ones instead */
+          pings_lost += pings_sent - ping_next;
+          ping_next = pings_sent;
+          ping_progress = now;
+        }
+        while(pings_sent < pings && pings_sent < ping_next + ping_preload) {
+          send_ping();
+        }
+        if(ping_next >= pings) {
+          printf("%lu echo replies in %lu ms, %lu replies/s, %lu lost\n",
+                 replies, (unsigned long)((ping_end - ping_start) / 1000),
+                 ping_end > ping_start ? (unsigned long)
+                 ((replies - replies_start) * 1000000 / (ping_end - ping_start)) : 0,
+                 pings_lost);
+          printf("%lu frames, %lu bytes on average\n", frames,
+                 frames ? frames_total_len / frames : 0);
+          return 0;
+        }
+      }
+    }
+
+    timeout = 100;
+    if(report_count > 0) {
+      timeout = (reports[report_head].time - now + 999) / 1000;
+    }
+    if(poll(&pfd, 1, timeout) > 0) {
+      if(pfd.revents & POLLIN) {
+        pty_input();
+      } else {
+        /* Nothing has opened the slave side yet */
+        usleep(10000);
+      }
+    }
+  }
+  return 0;
+}